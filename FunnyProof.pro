@@ -14,24 +14,54 @@ CONFIG += c++11
 
 SOURCES += \
     mainwindow.cpp \
+    arena.cpp \
+    congruence.cpp \
     dictionary.cpp \
+    disequality.cpp \
+    formulaset.cpp \
+    goalbits.cpp \
     language.cpp \
     main.cpp \
+    prooflimits.cpp \
     readwrite.cpp \
+    subsumption.cpp \
     utility.cpp \
-    theory.cpp
+    termindex.cpp \
+    theory.cpp \
+    transposition.cpp \
+    workpool.cpp
 
 HEADERS  += \
+    arena.h \
+    arena_imp.h \
     config.h \
+    congruence.h \
+    congruence_imp.h \
     dictionary.h \
     dictionary_imp.h \
+    disequality.h \
+    disequality_imp.h \
     error.h \
+    formulaset.h \
+    formulaset_imp.h \
+    goalbits.h \
+    goalbits_imp.h \
     language.h \
     language_imp.h \
     mainwindow.h \
+    prooflimits.h \
+    prooflimits_imp.h \
     readwrite.h \
+    subsumption.h \
+    subsumption_imp.h \
     utility.h \
     utility_imp.h \
-    theory.h
+    termindex.h \
+    termindex_imp.h \
+    theory.h \
+    transposition.h \
+    transposition_imp.h \
+    workpool.h \
+    workpool_imp.h
 
 FORMS    += mainwindow.ui
@@ -0,0 +1,25 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#ifndef INLINE
+
+#include "arena_imp.h"
+
+#endif
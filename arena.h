@@ -0,0 +1,153 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+/*!
+    \file "arena.h"
+
+    \author Nedeljko Stefanovic
+
+    \brief Region allocator for internal objects of terms and formulas.
+
+    While a NodeArena object exists, internal objects of terms and formulas
+    created by the same thread (together with their reference counters) are
+    taken from large chunks of memory by simply advancing a pointer.
+    Arenas are nested, the innermost living one is used.
+
+    Destroying an arena does not destroy objects. A chunk is returned to the
+    system when the arena has moved past it and every object placed in it is
+    destroyed, so objects that outlive the arena stay valid and only keep
+    their own chunk alive.
+
+    Objects meant to outlive a search are created inside a NodeArena::Heap
+    scope, where the thread allocates from the heap as if no arena existed.
+    Terms and formulas obtained in such a scope are promoted: an object
+    found in an arena is copied to the heap together with it's subobjects,
+    and the copy replaces it in the tables of hash-consing (see
+    "language.h"). Data computed lazily by an object on the heap is also
+    kept on the heap, so such objects never keep a chunk alive.
+*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include "config.h"
+
+class NodeArena
+{
+    struct Chunk
+    {
+        std::atomic<std::size_t> references;
+
+        DECLARE Chunk();
+    };
+
+    // Every block starts with pointer to it's chunk, or nullptr if the block
+    // is taken from the heap with no arena active, or unowned() if it is too
+    // large for a chunk of the active arena. Sizes are rounded for the
+    // strictest alignment.
+    static const std::size_t alignment = 16;
+    static const std::size_t headerSize = 16;
+
+    NodeArena *previous;
+    Chunk *chunk;
+    std::size_t used;
+    const std::size_t chunkSize;
+    std::size_t bytes;
+
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator =(const NodeArena&) = delete;
+    DECLARE static std::size_t roundUp(std::size_t size);
+    DECLARE static Chunk* unowned();
+    DECLARE static NodeArena*& current();
+    DECLARE static void release(Chunk *chunk);
+    DECLARE void retire();
+
+public:
+    class Heap
+    {
+        NodeArena *saved;
+        const bool enabled;
+
+        Heap(const Heap&) = delete;
+        Heap& operator =(const Heap&) = delete;
+
+    public:
+        DECLARE Heap(bool enabled = true);
+        DECLARE ~Heap();
+    };
+
+    DECLARE NodeArena(std::size_t chunkSize = 65536);
+    DECLARE ~NodeArena();
+    DECLARE std::size_t allocatedBytes() const;
+    DECLARE static NodeArena* active();
+    DECLARE static void* allocate(std::size_t size);
+    DECLARE static void deallocate(void *pointer);
+    DECLARE static bool persistent(const void *pointer);
+};
+
+// Allocator for containers and reference counters of shared pointers.
+template<typename T>
+class NodeAllocator
+{
+public:
+    typedef T value_type;
+
+    NodeAllocator()
+    {
+    }
+
+    template<typename U>
+    NodeAllocator(const NodeAllocator<U>&)
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(NodeArena::allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T *pointer, std::size_t)
+    {
+        NodeArena::deallocate(pointer);
+    }
+
+    template<typename U>
+    bool operator ==(const NodeAllocator<U>&) const
+    {
+        return true;
+    }
+
+    template<typename U>
+    bool operator !=(const NodeAllocator<U>&) const
+    {
+        return false;
+    }
+};
+
+#ifdef INLINE
+
+#include "arena_imp.h"
+
+#endif
+
+#endif // ARENA_H
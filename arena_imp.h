@@ -0,0 +1,171 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#ifndef ARENA_IMP_H
+#define ARENA_IMP_H
+
+#include "arena.h"
+
+NodeArena::Chunk::Chunk() :
+    references(1)
+{
+}
+
+std::size_t NodeArena::roundUp(std::size_t size)
+{
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+// Owner of large blocks taken from the heap while an arena is active, they
+// are not persistent.
+NodeArena::Chunk* NodeArena::unowned()
+{
+    static Chunk result;
+
+    return &result;
+}
+
+NodeArena*& NodeArena::current()
+{
+    thread_local static NodeArena *result = nullptr;
+
+    return result;
+}
+
+void NodeArena::release(Chunk *chunk)
+{
+    if (chunk->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        chunk->~Chunk();
+        ::operator delete(chunk);
+    }
+}
+
+void NodeArena::retire()
+{
+    if (chunk != nullptr) {
+        release(chunk);
+        chunk = nullptr;
+    }
+}
+
+// Heap scope is enabled only if asked, so that it can be opened on
+// condition.
+NodeArena::Heap::Heap(bool enabled) :
+    saved(current()),
+    enabled(enabled)
+{
+    if (enabled) {
+        current() = nullptr;
+    }
+}
+
+NodeArena::Heap::~Heap()
+{
+    if (enabled) {
+        current() = saved;
+    }
+}
+
+NodeArena::NodeArena(std::size_t chunkSize) :
+    previous(current()),
+    chunk(nullptr),
+    used(0),
+    chunkSize(roundUp(chunkSize)),
+    bytes(0)
+{
+    current() = this;
+}
+
+NodeArena::~NodeArena()
+{
+    retire();
+    current() = previous;
+}
+
+std::size_t NodeArena::allocatedBytes() const
+{
+    return bytes;
+}
+
+NodeArena* NodeArena::active()
+{
+    return current();
+}
+
+void* NodeArena::allocate(std::size_t size)
+{
+    const std::size_t total = headerSize + roundUp(size);
+    NodeArena *arena = current();
+    Chunk *owner = nullptr;
+    char *block;
+
+    if (arena != nullptr && total <= arena->chunkSize / 4) {
+        if (arena->chunk == nullptr || arena->used + total > arena->chunkSize) {
+            arena->retire();
+            arena->chunk = new(::operator new(roundUp(sizeof(Chunk)) + arena->chunkSize)) Chunk;
+            arena->used = 0;
+        }
+
+        owner = arena->chunk;
+        owner->references.fetch_add(1, std::memory_order_relaxed);
+        block = reinterpret_cast<char*>(owner) + roundUp(sizeof(Chunk)) + arena->used;
+        arena->used += total;
+    } else {
+        block = static_cast<char*>(::operator new(total));
+
+        if (arena != nullptr) {
+            owner = unowned();
+        }
+    }
+
+    if (arena != nullptr) {
+        arena->bytes += total;
+    }
+
+    *reinterpret_cast<Chunk**>(block) = owner;
+
+    return block + headerSize;
+}
+
+void NodeArena::deallocate(void *pointer)
+{
+    if (pointer == nullptr) {
+        return;
+    }
+
+    char *block = static_cast<char*>(pointer) - headerSize;
+    Chunk *owner = *reinterpret_cast<Chunk**>(block);
+
+    if (owner == nullptr || owner == unowned()) {
+        ::operator delete(block);
+    } else {
+        release(owner);
+    }
+}
+
+// Whether a block returned by allocate was taken while no arena was active.
+bool NodeArena::persistent(const void *pointer)
+{
+    const char *block = static_cast<const char*>(pointer) - headerSize;
+
+    return *reinterpret_cast<Chunk* const*>(block) == nullptr;
+}
+
+#endif // ARENA_IMP_H
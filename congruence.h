@@ -0,0 +1,95 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+/*!
+    \file "congruence.h"
+
+    \author Nedeljko Stefanovic
+
+    \brief Congruence closure of equalities between terms.
+
+    CongruenceClosure keeps classes of equal terms in a union-find structure.
+    Every term is a node whose arguments are nodes as well. Every class has
+    a use list of operation nodes with an argument in it, and a signature
+    table maps a symbol with classes of arguments to an operation node. When
+    two classes are merged, nodes on the use list of the smaller one get new
+    signatures, and a node whose signature is already in the table is merged
+    with the node found there, so f(a)=f(b) follows from a=b. Signatures
+    which contain a class that was merged stay in the table, but they are
+    never found again, since only roots are used in new signatures.
+
+    Terms given to add or merge are listed, classes returns listed terms
+    only. Their subterms are nodes as well, so congruence goes through them.
+*/
+
+#ifndef CONGRUENCE_H
+#define CONGRUENCE_H
+
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include "language.h"
+
+class CongruenceClosure
+{
+    struct Node
+    {
+        Term term;
+        std::vector<std::size_t> args;
+        bool listed;
+
+        DECLARE Node(const Term &term);
+    };
+
+    struct SignatureHash
+    {
+        DECLARE std::size_t operator ()(const std::vector<uint64_t> &signature) const;
+    };
+
+    std::unordered_map<Term, std::size_t> index;
+    std::vector<Node> nodes;
+    std::vector<std::size_t> parent;
+    std::vector<std::vector<std::size_t>> uses;
+    std::unordered_map<std::vector<uint64_t>, std::size_t, SignatureHash> signatures;
+    std::vector<std::pair<std::size_t, std::size_t>> pending;
+
+    DECLARE std::size_t node(const Term &term);
+    DECLARE std::size_t find(std::size_t i);
+    DECLARE std::vector<uint64_t> signature(std::size_t i);
+    DECLARE void enter(std::size_t i);
+    DECLARE void propagate();
+
+public:
+    DECLARE CongruenceClosure();
+    DECLARE CongruenceClosure(const std::set<Formula> &goal);
+    DECLARE void add(const Term &term);
+    DECLARE void merge(const Term &t1, const Term &t2);
+    DECLARE bool equivalent(const Term &t1, const Term &t2);
+    DECLARE std::size_t classOf(const Term &term);
+    DECLARE std::vector<std::set<Term>> classes();
+};
+
+#ifdef INLINE
+
+#include "congruence_imp.h"
+
+#endif
+
+#endif // CONGRUENCE_H
@@ -0,0 +1,236 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#ifndef CONGRUENCE_IMP_H
+#define CONGRUENCE_IMP_H
+
+#include "congruence.h"
+
+CongruenceClosure::Node::Node(const Term &term) :
+    term(term),
+    listed(false)
+{
+}
+
+std::size_t CongruenceClosure::SignatureHash::operator ()(const std::vector<uint64_t> &signature) const
+{
+    std::size_t result = signature.size();
+
+    for (auto i = signature.cbegin(); i!=signature.cend(); ++i) {
+        result = hashCombine(result, *i);
+    }
+
+    return result;
+}
+
+CongruenceClosure::CongruenceClosure()
+{
+}
+
+// Closure of equalities of goal. Terms of equalities and nonequalities are
+// listed.
+CongruenceClosure::CongruenceClosure(const std::set<Formula> &goal)
+{
+    for (auto i = goal.cbegin(); i!=goal.cend(); ++i) {
+        const Formula &f = *i;
+
+        if (f.type()==EQUALITY) {
+            for (std::size_t j = 0; j<f.terms().size(); ++j) {
+                if (j==0) {
+                    add(f.terms()[j]);
+                } else {
+                    merge(f.terms()[0], f.terms()[j]);
+                }
+            }
+        } else if (f.type()==NONEQUALITY) {
+            for (std::size_t j = 0; j<f.terms().size(); ++j) {
+                add(f.terms()[j]);
+            }
+        }
+    }
+}
+
+std::size_t CongruenceClosure::node(const Term &term)
+{
+    auto i = index.find(term);
+
+    if (i!=index.cend()) {
+        return i->second;
+    }
+
+    std::vector<std::size_t> args;
+
+    if (term.type()==OPERATION) {
+        for (std::size_t j = 0; j<term.args().size(); ++j) {
+            args.push_back(node(term.args()[j]));
+        }
+    }
+
+    std::size_t result = nodes.size();
+
+    index.insert(std::make_pair(term, result));
+    nodes.push_back(Node(term));
+    nodes.back().args = std::move(args);
+    parent.push_back(result);
+    uses.push_back(std::vector<std::size_t>());
+
+    if (nodes[result].args.empty()==false) {
+        for (auto j = nodes[result].args.cbegin(); j!=nodes[result].args.cend(); ++j) {
+            std::vector<std::size_t> &use = uses[find(*j)];
+
+            if (use.empty() || use.back()!=result) {
+                use.push_back(result);
+            }
+        }
+
+        enter(result);
+    }
+
+    return result;
+}
+
+std::size_t CongruenceClosure::find(std::size_t i)
+{
+    while (parent[i]!=i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+
+    return i;
+}
+
+std::vector<uint64_t> CongruenceClosure::signature(std::size_t i)
+{
+    const Symbol &symbol = nodes[i].term.symbol();
+    std::vector<uint64_t> result;
+
+    result.reserve(nodes[i].args.size()+2);
+    result.push_back(symbol.type);
+    result.push_back(symbol.id);
+
+    for (auto j = nodes[i].args.cbegin(); j!=nodes[i].args.cend(); ++j) {
+        result.push_back(find(*j));
+    }
+
+    return result;
+}
+
+// Puts signature of operation node i to the table, or schedules merge with
+// a node of another class which has the same signature.
+void CongruenceClosure::enter(std::size_t i)
+{
+    auto entry = signatures.insert(std::make_pair(signature(i), i));
+
+    if (entry.second==false && find(entry.first->second)!=find(i)) {
+        pending.push_back(std::make_pair(i, entry.first->second));
+    }
+}
+
+void CongruenceClosure::propagate()
+{
+    while (pending.empty()==false) {
+        std::size_t i = find(pending.back().first);
+        std::size_t j = find(pending.back().second);
+
+        pending.pop_back();
+
+        if (i==j) {
+            continue;
+        }
+
+        if (uses[i].size()>uses[j].size()) {
+            std::swap(i, j);
+        }
+
+        std::vector<std::size_t> moved = std::move(uses[i]);
+
+        uses[i].clear();
+        parent[i] = j;
+
+        for (auto k = moved.cbegin(); k!=moved.cend(); ++k) {
+            uses[j].push_back(*k);
+            enter(*k);
+        }
+    }
+}
+
+void CongruenceClosure::add(const Term &term)
+{
+    nodes[node(term)].listed = true;
+    propagate();
+}
+
+void CongruenceClosure::merge(const Term &t1, const Term &t2)
+{
+    std::size_t i = node(t1);
+    std::size_t j = node(t2);
+
+    nodes[i].listed = true;
+    nodes[j].listed = true;
+    pending.push_back(std::make_pair(i, j));
+    propagate();
+}
+
+bool CongruenceClosure::equivalent(const Term &t1, const Term &t2)
+{
+    std::size_t i = node(t1);
+    std::size_t j = node(t2);
+
+    propagate();
+
+    return find(i)==find(j);
+}
+
+// Root of the class of term, throws 0 when term is not in the closure.
+std::size_t CongruenceClosure::classOf(const Term &term)
+{
+    auto i = index.find(term);
+
+    if (i==index.cend()) {
+        throw(0);
+    }
+
+    return find(i->second);
+}
+
+// Classes of listed terms, in order of their first listed term.
+std::vector<std::set<Term>> CongruenceClosure::classes()
+{
+    std::unordered_map<std::size_t, std::size_t> positions;
+    std::vector<std::set<Term>> result;
+
+    for (std::size_t i = 0; i<nodes.size(); ++i) {
+        if (nodes[i].listed==false) {
+            continue;
+        }
+
+        auto position = positions.insert(std::make_pair(find(i), result.size()));
+
+        if (position.second) {
+            result.push_back(std::set<Term>());
+        }
+
+        result[position.first->second].insert(nodes[i].term);
+    }
+
+    return result;
+}
+
+#endif // CONGRUENCE_IMP_H
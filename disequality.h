@@ -0,0 +1,72 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+/*!
+    \file "disequality.h"
+
+    \author Nedeljko Stefanovic
+
+    \brief Index of nonequalities of a goal.
+
+    DisequalityIndex holds every pair of terms which are at different
+    positions of some nonequality, keyed by serial numbers of the terms in
+    a hash set, so whether a goal contains a nonequality of two terms is
+    answered in constant time. Pairs are kept in a vector as well, so a
+    goal is checked against a congruence closure in one pass over them.
+*/
+
+#ifndef DISEQUALITY_H
+#define DISEQUALITY_H
+
+#include <set>
+#include <unordered_set>
+#include <vector>
+#include "congruence.h"
+#include "language.h"
+
+class DisequalityIndex
+{
+    struct KeyHash
+    {
+        DECLARE std::size_t operator ()(const std::pair<uint64_t, uint64_t> &key) const;
+    };
+
+    std::unordered_set<std::pair<uint64_t, uint64_t>, KeyHash> keys;
+    std::vector<std::pair<Term, Term>> termPairs;
+
+    DECLARE static std::pair<uint64_t, uint64_t> key(const Term &t1, const Term &t2);
+
+public:
+    DECLARE DisequalityIndex();
+    DECLARE DisequalityIndex(const std::set<Formula> &goal);
+    DECLARE void add(const Term &t1, const Term &t2);
+    DECLARE void add(const Formula &nonequality);
+    DECLARE bool contains(const Term &t1, const Term &t2) const;
+    DECLARE const std::vector<std::pair<Term, Term>>& pairs() const;
+    DECLARE bool contradicts(CongruenceClosure &closure) const;
+};
+
+#ifdef INLINE
+
+#include "disequality_imp.h"
+
+#endif
+
+#endif // DISEQUALITY_H
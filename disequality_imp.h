@@ -0,0 +1,96 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#ifndef DISEQUALITY_IMP_H
+#define DISEQUALITY_IMP_H
+
+#include "disequality.h"
+
+std::size_t DisequalityIndex::KeyHash::operator ()(const std::pair<uint64_t, uint64_t> &key) const
+{
+    return hashCombine(hashCombine(0, key.first), key.second);
+}
+
+// Nonequality is symmetric, so a pair is keyed in order of serial numbers.
+std::pair<uint64_t, uint64_t> DisequalityIndex::key(const Term &t1, const Term &t2)
+{
+    if (t2.serial()<t1.serial()) {
+        return std::make_pair(t2.serial(), t1.serial());
+    }
+
+    return std::make_pair(t1.serial(), t2.serial());
+}
+
+DisequalityIndex::DisequalityIndex()
+{
+}
+
+DisequalityIndex::DisequalityIndex(const std::set<Formula> &goal)
+{
+    for (auto i = goal.cbegin(); i!=goal.cend(); ++i) {
+        if (i->type()==NONEQUALITY) {
+            add(*i);
+        }
+    }
+}
+
+void DisequalityIndex::add(const Term &t1, const Term &t2)
+{
+    if (keys.insert(key(t1, t2)).second) {
+        termPairs.push_back(std::make_pair(t1, t2));
+    }
+}
+
+// Adds every pair of terms at different positions of nonequality, so a term
+// repeated in it is paired with itself.
+void DisequalityIndex::add(const Formula &nonequality)
+{
+    const std::vector<Term> &terms = nonequality.terms();
+
+    for (std::size_t i = 1; i<terms.size(); ++i) {
+        for (std::size_t j = 0; j<i; ++j) {
+            add(terms[j], terms[i]);
+        }
+    }
+}
+
+bool DisequalityIndex::contains(const Term &t1, const Term &t2) const
+{
+    return keys.count(key(t1, t2))>0;
+}
+
+const std::vector<std::pair<Term, Term>>& DisequalityIndex::pairs() const
+{
+    return termPairs;
+}
+
+// Whether some pair is in the same class of closure.
+bool DisequalityIndex::contradicts(CongruenceClosure &closure) const
+{
+    for (auto i = termPairs.cbegin(); i!=termPairs.cend(); ++i) {
+        if (closure.equivalent(i->first, i->second)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#endif // DISEQUALITY_IMP_H
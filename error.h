@@ -45,7 +45,8 @@ enum ExceptionType
     DISJUNCTION_EXPECTED,
     CONJUNCTION_OR_DISJUNCTION_EXPECTED,
     IMPLICATION_OR_EQUIVALENCE_EXPECTED,
-    QUANTIFIER_EXPECTED
+    QUANTIFIER_EXPECTED,
+    PROOF_STOPPED
 };
 
 struct Exception
@@ -278,4 +279,14 @@ struct QuantifierExpectedException : public Exception
     }
 };
 
+// Thrown when a proof search reaches a limit or is cancelled. The reason is
+// kept by ProofControl (see "prooflimits.h").
+struct ProofStoppedException : public Exception
+{
+    ProofStoppedException() :
+        Exception(PROOF_STOPPED, L"Proof search is stopped")
+    {
+    }
+};
+
 #endif // ERROR_H
@@ -0,0 +1,108 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+/*!
+    \file "formulaset.h"
+
+    \author Nedeljko Stefanovic
+
+    \brief Persistent set of formulas.
+
+    FormulaSet is a balanced binary tree (AVL tree) ordered like
+    std::set<Formula>. Nodes are immutable and shared, so a copy takes
+    constant time and insert or erase makes O(log n) new nodes while the
+    rest of the tree stays shared with all other copies. Nodes are
+    allocated through NodeAllocator (see "arena.h").
+*/
+
+#ifndef FORMULASET_H
+#define FORMULASET_H
+
+#include <memory>
+#include <set>
+#include <vector>
+#include "arena.h"
+#include "language.h"
+
+class FormulaSet
+{
+    struct Node
+    {
+        const Formula formula;
+        const std::shared_ptr<const Node> left;
+        const std::shared_ptr<const Node> right;
+        const std::size_t height;
+        const std::size_t count;
+
+        DECLARE Node(const Formula &formula, const std::shared_ptr<const Node> &left, const std::shared_ptr<const Node> &right);
+    };
+
+    typedef std::shared_ptr<const Node> NodePtr;
+
+    NodePtr root;
+
+    DECLARE static std::size_t height(const NodePtr &node);
+    DECLARE static std::size_t count(const NodePtr &node);
+    DECLARE static NodePtr node(const Formula &formula, const NodePtr &left, const NodePtr &right);
+    DECLARE static NodePtr balance(const Formula &formula, const NodePtr &left, const NodePtr &right);
+    DECLARE static NodePtr insert(const NodePtr &node, const Formula &formula, bool &inserted);
+    DECLARE static NodePtr erase(const NodePtr &node, const Formula &formula, bool &erased);
+    DECLARE static NodePtr eraseFirst(const NodePtr &node);
+
+public:
+    class const_iterator
+    {
+        std::vector<const Node*> path;
+
+        DECLARE void descend(const Node *node);
+
+        friend class FormulaSet;
+
+    public:
+        DECLARE const_iterator();
+        DECLARE const Formula& operator *() const;
+        DECLARE const Formula* operator ->() const;
+        DECLARE const_iterator& operator ++();
+        DECLARE bool operator ==(const const_iterator &other) const;
+        DECLARE bool operator !=(const const_iterator &other) const;
+    };
+
+    DECLARE FormulaSet();
+    DECLARE FormulaSet(const std::set<Formula> &formulas);
+    DECLARE bool insert(const Formula &formula);
+    DECLARE bool erase(const Formula &formula);
+    DECLARE std::size_t count(const Formula &formula) const;
+    DECLARE std::size_t size() const;
+    DECLARE bool empty() const;
+    DECLARE const Formula& first() const;
+    DECLARE const_iterator begin() const;
+    DECLARE const_iterator end() const;
+    DECLARE const_iterator cbegin() const;
+    DECLARE const_iterator cend() const;
+    DECLARE std::set<Formula> toSet() const;
+};
+
+#ifdef INLINE
+
+#include "formulaset_imp.h"
+
+#endif
+
+#endif // FORMULASET_H
@@ -0,0 +1,306 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#ifndef FORMULASET_IMP_H
+#define FORMULASET_IMP_H
+
+#include <algorithm>
+#include "formulaset.h"
+
+FormulaSet::Node::Node(const Formula &formula, const std::shared_ptr<const Node> &left, const std::shared_ptr<const Node> &right) :
+    formula(formula),
+    left(left),
+    right(right),
+    height(1 + std::max(FormulaSet::height(left), FormulaSet::height(right))),
+    count(1 + FormulaSet::count(left) + FormulaSet::count(right))
+{
+}
+
+std::size_t FormulaSet::height(const NodePtr &node)
+{
+    return node ? node->height : 0;
+}
+
+std::size_t FormulaSet::count(const NodePtr &node)
+{
+    return node ? node->count : 0;
+}
+
+FormulaSet::NodePtr FormulaSet::node(const Formula &formula, const NodePtr &left, const NodePtr &right)
+{
+    return std::allocate_shared<Node>(NodeAllocator<Node>(), formula, left, right);
+}
+
+// Builds a node from subtrees whose heights differ by at most two.
+FormulaSet::NodePtr FormulaSet::balance(const Formula &formula, const NodePtr &left, const NodePtr &right)
+{
+    std::size_t hl = height(left);
+    std::size_t hr = height(right);
+
+    if (hl > hr + 1) {
+        if (height(left->left) >= height(left->right)) {
+            return node(left->formula, left->left, node(formula, left->right, right));
+        }
+
+        const NodePtr &lr = left->right;
+
+        return node(lr->formula, node(left->formula, left->left, lr->left), node(formula, lr->right, right));
+    }
+
+    if (hr > hl + 1) {
+        if (height(right->right) >= height(right->left)) {
+            return node(right->formula, node(formula, left, right->left), right->right);
+        }
+
+        const NodePtr &rl = right->left;
+
+        return node(rl->formula, node(formula, left, rl->left), node(right->formula, rl->right, right->right));
+    }
+
+    return node(formula, left, right);
+}
+
+FormulaSet::NodePtr FormulaSet::insert(const NodePtr &node, const Formula &formula, bool &inserted)
+{
+    if (!node) {
+        inserted = true;
+
+        return FormulaSet::node(formula, NodePtr(), NodePtr());
+    }
+
+    if (formula < node->formula) {
+        NodePtr left = insert(node->left, formula, inserted);
+
+        return inserted ? balance(node->formula, left, node->right) : node;
+    }
+
+    if (node->formula < formula) {
+        NodePtr right = insert(node->right, formula, inserted);
+
+        return inserted ? balance(node->formula, node->left, right) : node;
+    }
+
+    inserted = false;
+
+    return node;
+}
+
+FormulaSet::NodePtr FormulaSet::erase(const NodePtr &node, const Formula &formula, bool &erased)
+{
+    if (!node) {
+        erased = false;
+
+        return node;
+    }
+
+    if (formula < node->formula) {
+        NodePtr left = erase(node->left, formula, erased);
+
+        return erased ? balance(node->formula, left, node->right) : node;
+    }
+
+    if (node->formula < formula) {
+        NodePtr right = erase(node->right, formula, erased);
+
+        return erased ? balance(node->formula, node->left, right) : node;
+    }
+
+    erased = true;
+
+    if (!node->left) {
+        return node->right;
+    }
+
+    if (!node->right) {
+        return node->left;
+    }
+
+    const Node *next = node->right.get();
+
+    while (next->left) {
+        next = next->left.get();
+    }
+
+    return balance(next->formula, node->left, eraseFirst(node->right));
+}
+
+FormulaSet::NodePtr FormulaSet::eraseFirst(const NodePtr &node)
+{
+    if (!node->left) {
+        return node->right;
+    }
+
+    return balance(node->formula, eraseFirst(node->left), node->right);
+}
+
+void FormulaSet::const_iterator::descend(const Node *node)
+{
+    while (node != nullptr) {
+        path.push_back(node);
+        node = node->left.get();
+    }
+}
+
+FormulaSet::const_iterator::const_iterator()
+{
+}
+
+const Formula& FormulaSet::const_iterator::operator *() const
+{
+    return path.back()->formula;
+}
+
+const Formula* FormulaSet::const_iterator::operator ->() const
+{
+    return &path.back()->formula;
+}
+
+FormulaSet::const_iterator& FormulaSet::const_iterator::operator ++()
+{
+    const Node *node = path.back();
+
+    path.pop_back();
+    descend(node->right.get());
+
+    return *this;
+}
+
+bool FormulaSet::const_iterator::operator ==(const const_iterator &other) const
+{
+    if (path.empty() || other.path.empty()) {
+        return path.empty() && other.path.empty();
+    }
+
+    return path.back() == other.path.back();
+}
+
+bool FormulaSet::const_iterator::operator !=(const const_iterator &other) const
+{
+    return !operator ==(other);
+}
+
+FormulaSet::FormulaSet()
+{
+}
+
+FormulaSet::FormulaSet(const std::set<Formula> &formulas)
+{
+    for (auto i = formulas.cbegin(); i != formulas.cend(); ++i) {
+        insert(*i);
+    }
+}
+
+bool FormulaSet::insert(const Formula &formula)
+{
+    bool inserted;
+
+    root = insert(root, formula, inserted);
+
+    return inserted;
+}
+
+bool FormulaSet::erase(const Formula &formula)
+{
+    bool erased;
+
+    root = erase(root, formula, erased);
+
+    return erased;
+}
+
+std::size_t FormulaSet::count(const Formula &formula) const
+{
+    const Node *node = root.get();
+
+    while (node != nullptr) {
+        if (formula < node->formula) {
+            node = node->left.get();
+        } else if (node->formula < formula) {
+            node = node->right.get();
+        } else {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+std::size_t FormulaSet::size() const
+{
+    return count(root);
+}
+
+bool FormulaSet::empty() const
+{
+    return !root;
+}
+
+// Least formula of a nonempty set.
+const Formula& FormulaSet::first() const
+{
+    const Node *node = root.get();
+
+    if (node == nullptr) {
+        throw(0);
+    }
+
+    while (node->left) {
+        node = node->left.get();
+    }
+
+    return node->formula;
+}
+
+FormulaSet::const_iterator FormulaSet::begin() const
+{
+    const_iterator result;
+
+    result.descend(root.get());
+
+    return result;
+}
+
+FormulaSet::const_iterator FormulaSet::end() const
+{
+    return const_iterator();
+}
+
+FormulaSet::const_iterator FormulaSet::cbegin() const
+{
+    return begin();
+}
+
+FormulaSet::const_iterator FormulaSet::cend() const
+{
+    return end();
+}
+
+std::set<Formula> FormulaSet::toSet() const
+{
+    std::set<Formula> result;
+
+    for (const_iterator i = begin(); i != end(); ++i) {
+        result.insert(result.end(), *i);
+    }
+
+    return result;
+}
+
+#endif // FORMULASET_IMP_H
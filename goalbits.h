@@ -0,0 +1,77 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+/*!
+    \file "goalbits.h"
+
+    \author Nedeljko Stefanovic
+
+    \brief Goals as bitsets of literal identifiers.
+
+    LiteralIds gives every distinct formula of a system a dense identifier,
+    in the order in which formulas are added. GoalBits is a goal stored as a
+    bitset over these identifiers, so inclusion of one goal in another is a
+    word-wise AND and compare. Loops over words have no early exit, so the
+    compiler can vectorize them. A one word signature with bit id%64 set for
+    every identifier rejects most pairs before words are compared.
+    Identifiers may be added after a bitset was made, bitsets of different
+    length are compared as if padded with zeros.
+*/
+
+#ifndef GOALBITS_H
+#define GOALBITS_H
+
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include "language.h"
+
+class LiteralIds
+{
+    std::unordered_map<Formula, std::size_t> ids;
+
+public:
+    DECLARE LiteralIds();
+    DECLARE LiteralIds(const std::set<std::set<Formula>> &system);
+    DECLARE std::size_t add(const Formula &formula);
+    DECLARE std::size_t id(const Formula &formula) const;
+    DECLARE std::size_t size() const;
+};
+
+class GoalBits
+{
+    std::vector<uint64_t> words;
+    uint64_t signature;
+    std::size_t count;
+
+public:
+    DECLARE GoalBits(const LiteralIds &ids, const std::set<Formula> &goal);
+    DECLARE std::size_t size() const;
+    DECLARE bool includes(const GoalBits &other) const;
+};
+
+#ifdef INLINE
+
+#include "goalbits_imp.h"
+
+#endif
+
+#endif // GOALBITS_H
@@ -0,0 +1,103 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#ifndef GOALBITS_IMP_H
+#define GOALBITS_IMP_H
+
+#include <algorithm>
+#include "goalbits.h"
+
+LiteralIds::LiteralIds()
+{
+}
+
+LiteralIds::LiteralIds(const std::set<std::set<Formula>> &system)
+{
+    for (auto i = system.cbegin(); i!=system.cend(); ++i) {
+        for (auto j = i->cbegin(); j!=i->cend(); ++j) {
+            add(*j);
+        }
+    }
+}
+
+std::size_t LiteralIds::add(const Formula &formula)
+{
+    return ids.insert(std::make_pair(formula, ids.size())).first->second;
+}
+
+// Throws 0 when formula was not added.
+std::size_t LiteralIds::id(const Formula &formula) const
+{
+    auto i = ids.find(formula);
+
+    if (i==ids.cend()) {
+        throw(0);
+    }
+
+    return i->second;
+}
+
+std::size_t LiteralIds::size() const
+{
+    return ids.size();
+}
+
+GoalBits::GoalBits(const LiteralIds &ids, const std::set<Formula> &goal) :
+    words((ids.size()+63)/64, 0),
+    signature(0),
+    count(goal.size())
+{
+    for (auto i = goal.cbegin(); i!=goal.cend(); ++i) {
+        std::size_t id = ids.id(*i);
+
+        words[id/64] |= uint64_t(1) << (id%64);
+        signature |= uint64_t(1) << (id%64);
+    }
+}
+
+std::size_t GoalBits::size() const
+{
+    return count;
+}
+
+// Whether every literal of other is in this goal.
+bool GoalBits::includes(const GoalBits &other) const
+{
+    if (other.count>count || (other.signature & ~signature)!=0) {
+        return false;
+    }
+
+    const uint64_t *first = words.data();
+    const uint64_t *second = other.words.data();
+    std::size_t common = std::min(words.size(), other.words.size());
+    uint64_t missing = 0;
+
+    for (std::size_t i = 0; i<common; ++i) {
+        missing |= second[i] & ~first[i];
+    }
+
+    for (std::size_t i = common; i<other.words.size(); ++i) {
+        missing |= second[i];
+    }
+
+    return missing==0;
+}
+
+#endif // GOALBITS_IMP_H
@@ -26,16 +26,34 @@
     variables, terms and formulas.
 
     These logical objects are implemented as immutable objects.
+    Internal objects are allocated through NodeArena (see "arena.h").
     Copy construction is enabled, but assignment is disabled.
 
     All these classes have comparision operators "=", "!=" amd "<",
-    comparision function "cmp" and hash function.
+    comparision function "cmp" and hash function. Hash of a term or a formula
+    depends only on it's structure (and order of arguments), is computed once
+    when the internal object is created and can be used with std::hash.
 
     All program objects representing terms and formulas shares internal
     representation of this type of logical object. A object constructed as copy
     of another object uses the same shared internal object.
-    Difference of addreses of internal objects does not imply difference of
-    represented logical objects.
+    Terms and formulas are hash-consed: structurally equal objects always
+    share the same internal object, or a copy of it promoted out of an arena
+    (see "arena.h") with the same serial number. So equality is a
+    comparision of serial numbers.
+    Order is structural (symbols first, then arguments), so iteration order
+    of sets of terms and formulas does not depend on the order in which
+    internal objects were created. Comparision stops at the first shared
+    subobject.
+
+    Terms and formulas are persistent if they and all their subobjects were
+    allocated while no arena was active. Every term or formula obtained
+    while no arena is active is persistent.
+
+    Terms and formulas can be shared between threads. Data computed lazily
+    by internal objects (like sets of free variables) is computed exactly
+    once under std::call_once and never changes afterwards, so concurrent
+    readers need no further synchronization.
 
     Any symbol object have it's own id. Symbol object constructed without copy
     constructor representing a new symbol with new id.
@@ -49,7 +67,9 @@
 #include <inttypes.h>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <unordered_map>
 #include <vector>
 #include "config.h"
 
@@ -96,6 +116,9 @@ public:
     DECLARE int compare(const Symbol &other) const;
 };
 
+// Order sensitive combination of hash values.
+DECLARE size_t hashCombine(size_t seed, uint64_t value);
+
 class FalseSymbol : public Symbol
 {
     DECLARE FalseSymbol();
@@ -238,6 +261,57 @@ public:
     DECLARE Variable(const Symbol &other);
 };
 
+// Immutable set of variables sorted by id. Copies share the same storage.
+// Signature has bit (id mod 64) set for every element, so most negative
+// queries are answered without looking at elements.
+class VariableSet
+{
+    std::shared_ptr<const std::vector<Variable>> data;
+    uint64_t mask;
+
+    DECLARE VariableSet(std::vector<Variable> &&variables);
+    DECLARE static const std::vector<Variable>& none();
+
+public:
+    typedef std::vector<Variable>::const_iterator const_iterator;
+
+    DECLARE VariableSet();
+    DECLARE VariableSet(const Variable &variable);
+    DECLARE VariableSet(const VariableSet &other);
+    DECLARE VariableSet& operator =(const VariableSet &other);
+    DECLARE bool empty() const;
+    DECLARE std::size_t size() const;
+    DECLARE std::size_t count(const Variable &variable) const;
+    DECLARE bool includes(const VariableSet &other) const;
+    DECLARE bool intersects(const VariableSet &other) const;
+    DECLARE uint64_t signature() const;
+    DECLARE const_iterator begin() const;
+    DECLARE const_iterator end() const;
+    DECLARE const_iterator cbegin() const;
+    DECLARE const_iterator cend() const;
+    DECLARE VariableSet unite(const VariableSet &other) const;
+    DECLARE VariableSet remove(const std::vector<Variable> &variables) const;
+    DECLARE static uint64_t signature(const Variable &variable);
+};
+
+// Top symbols of a term at positions e, 1, 2, 3, 1.1, 1.2, 2.1 and 2.2.
+// Positions below a variable may hold anything, positions that are not in
+// the term hold absent. Terms with incompatible fingerprints are not
+// unifiable. Symbols are folded to 32 bits, so equal codes do not imply
+// equal symbols, only the converse is used.
+struct Fingerprint
+{
+    static const std::size_t size = 8;
+    static const uint32_t absent = 0;
+    static const uint32_t variable = 1;
+    static const uint32_t belowVariable = 2;
+
+    uint32_t data[size];
+
+    DECLARE static uint32_t code(const Symbol &symbol);
+    DECLARE bool unifiable(const Fingerprint &other) const;
+};
+
 class TermEnvironment
 {
 public:
@@ -246,10 +320,32 @@ public:
 private:
     class TermPrivate
     {
+        // Table of all living terms, used for hash-consing. It is split into
+        // shards by hash, each guarded by it's own mutex.
+        struct Shard
+        {
+            std::mutex mutex;
+            std::unordered_multimap<size_t, std::pair<const TermPrivate*, std::weak_ptr<TermPrivate>>> nodes;
+        };
+
+        static const std::size_t shardBits = 6;
+
+        DECLARE static Shard& shard(size_t hash);
+        DECLARE static std::shared_ptr<TermPrivate> lookup(Shard &shard, const TermPrivate &term);
+        DECLARE static void release(TermPrivate *term);
+
     public:
         const Symbol symbol;
         const std::vector<Term> args;
-        mutable std::shared_ptr<std::set<Variable>> freeVariables;
+        const size_t hashValue;
+        const Fingerprint fingerprint;
+        const uint64_t serial;
+        mutable VariableSet freeVariables;
+        mutable std::once_flag freeVariablesFlag;
+
+        // Copy which replaced this term in the table, kept alive as long as
+        // this term, so that the table does not lose the term.
+        mutable std::shared_ptr<TermPrivate> promoted;
 
     protected:
         DECLARE TermPrivate(Symbol symbol);
@@ -259,14 +355,25 @@ private:
     public:
         DECLARE TermPrivate(const TermPrivate &other);
         DECLARE TermPrivate(TermPrivate &&other);
+        DECLARE TermPrivate(const TermPrivate &other, std::vector<Term> &&args);
+        DECLARE static void* operator new(std::size_t size);
+        DECLARE static void operator delete(void *pointer);
+        DECLARE static uint64_t nextSerial();
+        DECLARE static std::shared_ptr<TermPrivate> intern(TermPrivate *term);
+        DECLARE static bool settled(const std::shared_ptr<TermPrivate> &term);
+        DECLARE static std::shared_ptr<TermPrivate> promote(const std::shared_ptr<TermPrivate> &term);
         DECLARE static const TermPrivate& dummy();
+        DECLARE static size_t hashOf(const Symbol &symbol, const std::vector<Term> &args);
+        DECLARE static Fingerprint fingerprintOf(const Symbol &symbol, const std::vector<Term> &args);
+        DECLARE bool equals(const Symbol &symbol, const std::vector<Term> &args) const;
         DECLARE bool operator ==(const TermPrivate &other) const;
         DECLARE bool operator !=(const TermPrivate &other) const;
         DECLARE int compare(const TermPrivate &other) const;
         DECLARE bool operator <(const TermPrivate &other) const;
         DECLARE size_t hash() const;
         DECLARE bool isFreeVariable(const Variable &variable) const;
-        DECLARE const std::set<Variable>& getFreeVariables() const;
+        DECLARE VariableSet computeFreeVariables() const;
+        DECLARE const VariableSet& getFreeVariables() const;
     };
 
     struct EmptyTermPrivate : public TermPrivate
@@ -293,15 +400,27 @@ private:
 public:
     class Substitution
     {
+        DECLARE static std::vector<std::pair<Variable, Term>> fromMap(const std::map<Variable, Term> &valuation);
+        DECLARE static uint64_t signatureOf(const std::vector<std::pair<Variable, Term>> &data);
+        DECLARE Substitution(std::vector<std::pair<Variable, Term>> &&data);
+
     public:
         DECLARE Substitution();
         DECLARE Substitution(const std::map<Variable, Term> &valuation);
         DECLARE Substitution(std::map<Variable, Term> &&valuation);
         DECLARE Substitution(const Variable &variable, const Term &term);
+        DECLARE Substitution(const Substitution &other);
         DECLARE Term operator ()(const Variable &variable) const;
+        DECLARE const Term* find(const Variable &variable) const;
+        DECLARE bool affects(const VariableSet &variables) const;
+        DECLARE bool empty() const;
+        DECLARE size_t size() const;
         DECLARE Substitution operator [](const Substitution &other) const;
 
-        const std::map<Variable, Term> data;
+        // Pairs sorted by id of the variable, and signature of the domain
+        // in the sense of VariableSet.
+        const std::vector<std::pair<Variable, Term>> data;
+        const uint64_t mask;
     };
 
     class Term
@@ -309,6 +428,9 @@ public:
         const std::shared_ptr<TermPrivate> termPtr;
         const TermPrivate &term;
         Term& operator =(const Term&) = delete;
+        DECLARE Term(const std::shared_ptr<TermPrivate> &termPtr);
+
+        friend class TermPrivate;
 
     public:
         DECLARE Term();
@@ -322,14 +444,19 @@ public:
         DECLARE int compare(const Term &other) const;
         DECLARE bool operator <(const Term &other) const;
         DECLARE size_t hash() const;
+        DECLARE const Fingerprint& fingerprint() const;
         DECLARE SymbolType type() const;
         DECLARE uint64_t id() const;
+        DECLARE uint64_t serial() const;
         DECLARE const Symbol& symbol() const;
         DECLARE size_t arity() const;
         DECLARE const std::vector<Term>& args() const;
         DECLARE bool isFreeVariable(const Variable &variable) const;
-        DECLARE const std::set<Variable>& getFreeVariables() const;
+        DECLARE const VariableSet& getFreeVariables() const;
+        DECLARE bool isGround() const;
         DECLARE bool isEmpty() const;
+        DECLARE bool isPersistent() const;
+        DECLARE Term persistent() const;
         DECLARE Term operator [](const Substitution &valuation) const;
         DECLARE static const Term& dummy();
     };
@@ -337,8 +464,38 @@ public:
     DECLARE static std::vector<Variable> oneVariable(const Variable &variable);
     DECLARE static std::vector<Term> oneTerm(const Term &term);
     DECLARE static std::vector<Term> twoTerms(const Term &term1, const Term &term2);
-    DECLARE static Substitution unificator(std::vector<std::pair<Term, Term>> &conditions, bool &ok);
+    DECLARE static Substitution unificator(const std::vector<std::pair<Term, Term>> &conditions, bool &ok);
     DECLARE static Substitution unificator(const Term &t1, const Term &t2, bool &ok);
+    DECLARE static Substitution naiveUnificator(std::vector<std::pair<Term, Term>> &conditions, bool &ok);
+    DECLARE static Substitution naiveUnificator(const Term &t1, const Term &t2, bool &ok);
+    DECLARE static bool match(const Term &pattern, const Term &target, std::vector<std::pair<Variable, Term>> &bindings);
+    DECLARE static Substitution matcher(const Term &pattern, const Term &target, bool &ok);
+    DECLARE static const Term* binding(const Variable &variable, const std::vector<std::pair<Variable, Term>> &bindings);
+
+private:
+    // Union-find over the distinct subterms of a unification problem.
+    // Terms are hash-consed, so a subterm shared in the input is a single
+    // node here. Classes are merged without substituting, and the occurs
+    // check is deferred to the final pass which builds the unificator.
+    class UnificationGraph
+    {
+        std::unordered_map<uint64_t, size_t> index;
+        std::vector<Term> nodes;
+        std::vector<size_t> parent;
+        std::vector<size_t> rank;
+        std::vector<size_t> schema;
+        std::vector<int> state;
+        std::unordered_map<size_t, Term> resolved;
+
+        DECLARE size_t node(const Term &term);
+        DECLARE size_t find(size_t i);
+        DECLARE void link(size_t i, size_t j, size_t newSchema);
+        DECLARE bool resolve(size_t i);
+
+    public:
+        DECLARE bool unify(const Term &t1, const Term &t2);
+        DECLARE Substitution unificator(bool &ok);
+    };
 };
 
 typedef TermEnvironment::Term Term;
@@ -362,12 +519,48 @@ public:
 private:
     class FormulaPrivate
     {
+        // Table of all living formulas, used for hash-consing. It is split
+        // into shards by hash, each guarded by it's own mutex.
+        struct Shard
+        {
+            std::mutex mutex;
+            std::unordered_multimap<size_t, std::pair<const FormulaPrivate*, std::weak_ptr<FormulaPrivate>>> nodes;
+        };
+
+        static const std::size_t shardBits = 6;
+
+        DECLARE static Shard& shard(size_t hash);
+        DECLARE static std::shared_ptr<FormulaPrivate> lookup(Shard &shard, const FormulaPrivate &formula);
+        DECLARE static void release(FormulaPrivate *formula);
+
     public:
         const Symbol symbol;
         const std::vector<Term> terms;
         const std::vector<Formula> formulas;
         const std::vector<Variable> variables;
-        mutable std::shared_ptr<std::set<Variable>> freeVariables;
+        const size_t hashValue;
+        const uint64_t serial;
+        mutable VariableSet freeVariables;
+        mutable std::once_flag freeVariablesFlag;
+
+        // Result of simplify, computed once. A formula which simplifies to
+        // itself only sets the flag, so that it does not own itself.
+        mutable std::shared_ptr<FormulaPrivate> simplified;
+        mutable bool simplifiedSelf;
+        mutable std::atomic<bool> simplifiedReady;
+        mutable std::once_flag simplifiedFlag;
+
+        // Uniform type and it's components, computed once. A literal which
+        // is the formula itself is not stored in uniformArgs (the formula
+        // would own itself), uniformSelf is set instead.
+        mutable UniformType uniformTypeValue;
+        mutable std::vector<Formula> uniformArgs;
+        mutable std::set<Variable> uniformVariables;
+        mutable bool uniformSelf;
+        mutable std::once_flag uniformTypeFlag;
+
+        // As for terms.
+        mutable std::shared_ptr<FormulaPrivate> promoted;
 
         DECLARE FormulaPrivate();
         DECLARE FormulaPrivate(const Symbol &symbol);
@@ -383,12 +576,24 @@ private:
         DECLARE FormulaPrivate(const Symbol &symbol, std::vector<Term> &&terms, std::vector<Formula> &&formulas);
         DECLARE FormulaPrivate(const FormulaPrivate &other);
         DECLARE FormulaPrivate(FormulaPrivate &&other);
+        DECLARE FormulaPrivate(const FormulaPrivate &other, std::vector<Term> &&terms, std::vector<Formula> &&formulas);
+        DECLARE static void* operator new(std::size_t size);
+        DECLARE static void operator delete(void *pointer);
+        DECLARE static uint64_t nextSerial();
+        DECLARE static std::shared_ptr<FormulaPrivate> intern(FormulaPrivate *formula);
+        DECLARE static bool settled(const std::shared_ptr<FormulaPrivate> &formula);
+        DECLARE static std::shared_ptr<FormulaPrivate> promote(const std::shared_ptr<FormulaPrivate> &formula);
+        DECLARE static size_t hashOf(const Symbol &symbol, const std::vector<Term> &terms,
+                                     const std::vector<Formula> &formulas, const std::vector<Variable> &variables);
+        DECLARE size_t hash() const;
+        DECLARE bool equals(const FormulaPrivate &other) const;
         DECLARE bool operator ==(const FormulaPrivate &other) const;
         DECLARE bool operator !=(const FormulaPrivate &other) const;
         DECLARE int compare(const FormulaPrivate &other) const;
         DECLARE bool operator <(const FormulaPrivate &other) const;
         DECLARE bool isFreeVariable(const Variable &variable) const;
-        DECLARE const std::set<Variable>& getFreeVariables() const;
+        DECLARE VariableSet computeFreeVariables() const;
+        DECLARE const VariableSet& getFreeVariables() const;
         DECLARE static const FormulaPrivate& dummy();
     };
 
@@ -511,6 +716,12 @@ public:
 
         Formula& operator =(const Formula&) = delete;
         DECLARE Formula(FormulaPrivate *formulaPtr);
+        DECLARE Formula(const std::shared_ptr<FormulaPrivate> &formulaPtr);
+        DECLARE Formula simplify(std::unordered_map<Formula, Formula> &memo) const;
+        DECLARE Formula simplifyNode(std::unordered_map<Formula, Formula> &memo) const;
+        DECLARE void setSimplified(const Formula &result) const;
+        DECLARE UniformType computeUniformType(std::vector<Formula> &args, std::set<Variable> &vars) const;
+        DECLARE const FormulaPrivate& classified() const;
 
     public:
         DECLARE Formula();
@@ -522,16 +733,25 @@ public:
         DECLARE const Symbol& symbol() const;
         DECLARE SymbolType type() const;
         DECLARE uint64_t id() const;
+        DECLARE uint64_t serial() const;
+        DECLARE size_t hash() const;
         DECLARE const std::vector<Term>& terms() const;
         DECLARE const std::vector<Formula>& formulas() const;
         DECLARE const std::vector<Variable>& variables() const;
         DECLARE bool isFreeVariable(const Variable &variable) const;
-        DECLARE const std::set<Variable>& getFreeVariables() const;
+        DECLARE const VariableSet& getFreeVariables() const;
+        DECLARE bool isGround() const;
         DECLARE bool isEmpty() const;
+        DECLARE bool isPersistent() const;
+        DECLARE Formula persistent() const;
         DECLARE Formula operator [](const TermEnvironment::Substitution &substitution) const;
         DECLARE static const Formula& dummy();
         DECLARE Formula simplify() const;
         DECLARE UniformType uniformType(std::vector<Formula> &args, std::set<Variable> &vars) const;
+        DECLARE UniformType uniformType() const;
+        DECLARE const std::vector<Formula>& uniformArgs() const;
+        DECLARE const std::set<Variable>& uniformVariables() const;
+        DECLARE Formula literal() const;
 
         friend struct FalseFormula;
         friend struct TrueFormula;
@@ -545,6 +765,7 @@ public:
         friend struct EquivalenceFormula;
         friend struct UniversalFormula;
         friend struct ExistentialFormula;
+        friend class FormulaPrivate;
     };
 
     struct EmptyFormula : public Formula
@@ -628,10 +849,34 @@ public:
         DECLARE ExistentialFormula(const Formula &formula, const std::vector<Variable> &variables);
         DECLARE ExistentialFormula(const Formula &formula, std::vector<Variable> &&variables);
     };
+
+    DECLARE static bool match(const Formula &pattern, const Formula &target, std::vector<std::pair<Variable, Term>> &bindings);
+    DECLARE static Substitution matcher(const Formula &pattern, const Formula &target, bool &ok);
 };
 
 typedef FormulaEnvironment::Formula Formula;
 
+namespace std
+{
+    template<>
+    struct hash<Term>
+    {
+        size_t operator ()(const Term &term) const
+        {
+            return term.hash();
+        }
+    };
+
+    template<>
+    struct hash<Formula>
+    {
+        size_t operator ()(const Formula &formula) const
+        {
+            return formula.hash();
+        }
+    };
+}
+
 #ifdef INLINE
 
 #include "language_imp.h"
@@ -21,6 +21,7 @@
 #define LANGUAGE_IMP_H
 
 #include <algorithm>
+#include "arena.h"
 #include "language.h"
 
 Symbol::Symbol() :
@@ -75,6 +76,17 @@ int Symbol::compare(const Symbol &other) const
     return id > other.id;
 }
 
+size_t hashCombine(size_t seed, uint64_t value)
+{
+    uint64_t result = seed ^ (value + 0x9e3779b97f4a7c15ULL + (uint64_t(seed) << 6) + (uint64_t(seed) >> 2));
+
+    // Finalizer of splitmix64, so that every input bit affects every output bit.
+    result = (result ^ (result >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    result = (result ^ (result >> 27)) * 0x94d049bb133111ebULL;
+
+    return size_t(result ^ (result >> 31));
+}
+
 FalseSymbol::FalseSymbol() :
     Symbol(FALSE_SYMBOL)
 {
@@ -334,355 +346,873 @@ Variable::Variable(const Symbol &other) :
     }
 }
 
-TermEnvironment::TermPrivate::TermPrivate(Symbol symbol) :
-    symbol(symbol),
-    args(),
-    freeVariables()
+VariableSet::VariableSet(std::vector<Variable> &&variables) :
+    mask(0)
 {
-}
+    for (size_t i = 0; i < variables.size(); ++i) {
+        mask |= signature(variables[i]);
+    }
 
-TermEnvironment::TermPrivate::TermPrivate(Symbol symbol, const std::vector<Term> &args) :
-    symbol(symbol),
-    args(args),
-    freeVariables()
-{
-    if (args.size() != symbol.arity) {
-        throw(0);
+    if (variables.empty() == false) {
+        data = std::make_shared<const std::vector<Variable>>(std::move(variables));
     }
 }
 
-TermEnvironment::TermPrivate::TermPrivate(Symbol symbol, std::vector<Term> &&args) :
-    symbol(symbol),
-    args(std::move(args)),
-    freeVariables()
+const std::vector<Variable>& VariableSet::none()
 {
-    if (args.size() != symbol.arity) {
-        throw(0);
-    }
+    static const std::vector<Variable> result;
+
+    return result;
 }
 
-TermEnvironment::TermPrivate::TermPrivate(const TermPrivate &other) :
-    symbol(other.symbol),
-    args(other.args),
-    freeVariables(other.freeVariables)
+VariableSet::VariableSet() :
+    mask(0)
 {
 }
 
-TermEnvironment::TermPrivate::TermPrivate(TermPrivate &&other) :
-    symbol(other.symbol),
-    args(std::move(other.args)),
-    freeVariables(std::move(other.freeVariables))
+VariableSet::VariableSet(const Variable &variable) :
+    VariableSet(std::vector<Variable>(1, variable))
 {
 }
 
-const TermEnvironment::TermPrivate& TermEnvironment::TermPrivate::dummy()
+VariableSet::VariableSet(const VariableSet &other) :
+    data(other.data),
+    mask(other.mask)
 {
-    thread_local static EmptyTermPrivate result;
-
-    return result;
 }
 
-bool TermEnvironment::TermPrivate::operator ==(const TermPrivate &other) const
+VariableSet& VariableSet::operator =(const VariableSet &other)
 {
-    if (this == &other) {
-        return true;
-    }
-
-    if (symbol != other.symbol) {
-        return false;
-    }
-
-    if (symbol.arity == 0) {
-        return true;
-    }
-
-    if (args.size() != other.args.size()) {
-        return false;
-    }
+    data = other.data;
+    mask = other.mask;
 
-    for (std::size_t i = 0; i < args.size(); ++i) {
-        if (args[i] != other.args[i]) {
-            return false;
-        }
-    }
+    return *this;
+}
 
-    return true;
+bool VariableSet::empty() const
+{
+    return (bool)data == false;
 }
 
-bool TermEnvironment::TermPrivate::operator !=(const TermPrivate &other) const
+std::size_t VariableSet::size() const
 {
-    return operator ==(other) == false;
+    return empty() ? 0 : data->size();
 }
 
-int TermEnvironment::TermPrivate::compare(const TermPrivate &other) const
+std::size_t VariableSet::count(const Variable &variable) const
 {
-    if (this == &other) {
+    if ((mask & signature(variable)) == 0) {
         return 0;
     }
 
-    int result = symbol.compare(other.symbol);
+    return std::binary_search(data->cbegin(), data->cend(), variable) ? 1 : 0;
+}
 
-    if (result != 0) {
-        return result;
+bool VariableSet::includes(const VariableSet &other) const
+{
+    if ((other.mask & ~mask) != 0) {
+        return false;
     }
 
-    if (args.size() < other.args.size()) {
-        return -1;
+    if (other.empty() || data == other.data) {
+        return true;
     }
 
-    if (args.size() > other.args.size()) {
-        return 1;
+    return std::includes(cbegin(), cend(), other.cbegin(), other.cend());
+}
+
+bool VariableSet::intersects(const VariableSet &other) const
+{
+    if ((mask & other.mask) == 0) {
+        return false;
     }
 
-    for (std::size_t i = 0; i < args.size(); ++i) {
-        result = args[i].compare(other.args[i]);
+    const_iterator i = cbegin();
+    const_iterator j = other.cbegin();
 
-        if (result != 0) {
-            return result;
+    while (i != cend() && j != other.cend()) {
+        if (*i < *j) {
+            ++i;
+        } else if (*j < *i) {
+            ++j;
+        } else {
+            return true;
         }
     }
 
-    return 0;
+    return false;
 }
 
-bool TermEnvironment::TermPrivate::operator <(const TermPrivate &other) const
+uint64_t VariableSet::signature() const
 {
-   return compare(other) < 0;
+    return mask;
 }
 
-size_t TermEnvironment::TermPrivate::hash() const
+VariableSet::const_iterator VariableSet::begin() const
 {
-    size_t result = symbol.id;
-
-    for (size_t i = 0; i < args.size(); ++i) {
-        result ^= args[i].hash();
-    }
+    return empty() ? none().cbegin() : data->cbegin();
+}
 
-    return result;
+VariableSet::const_iterator VariableSet::end() const
+{
+    return empty() ? none().cend() : data->cend();
 }
 
-bool TermEnvironment::TermPrivate::isFreeVariable(const Variable &variable) const
+VariableSet::const_iterator VariableSet::cbegin() const
 {
-    switch (symbol.type) {
-    case NONE_SYMBOL: case FALSE_SYMBOL: case TRUE_SYMBOL:
-        return false;
+    return begin();
+}
 
-        break;
+VariableSet::const_iterator VariableSet::cend() const
+{
+    return end();
+}
 
-    case VARIABLE:
-        return symbol == variable;
+VariableSet VariableSet::unite(const VariableSet &other) const
+{
+    if (includes(other)) {
+        return *this;
+    }
 
-        break;
+    if (other.includes(*this)) {
+        return other;
+    }
 
-    case CONSTANT:
-        return false;
+    std::vector<Variable> result;
+    const_iterator i = cbegin();
+    const_iterator j = other.cbegin();
 
-        break;
+    result.reserve(size() + other.size());
 
-    case OPERATION:
-        for (std::size_t i = 0; i < args.size(); ++i) {
-            if (args[i].isFreeVariable(variable)) {
-                return true;
-            }
+    while (i != cend() || j != other.cend()) {
+        if (j == other.cend() || (i != cend() && *i < *j)) {
+            result.push_back(*i);
+            ++i;
+        } else if (i == cend() || *j < *i) {
+            result.push_back(*j);
+            ++j;
+        } else {
+            result.push_back(*i);
+            ++i;
+            ++j;
         }
+    }
 
-        return false;
+    return VariableSet(std::move(result));
+}
 
-        break;
+VariableSet VariableSet::remove(const std::vector<Variable> &variables) const
+{
+    bool found = false;
 
-    default:
-        throw(0);
+    for (size_t i = 0; i < variables.size() && found == false; ++i) {
+        found = count(variables[i]) > 0;
+    }
 
-        break;
+    if (found == false) {
+        return *this;
     }
-}
 
-const std::set<Variable>& TermEnvironment::TermPrivate::getFreeVariables() const
-{
-    if ((bool)freeVariables == false) {
-        std::shared_ptr<std::set<Variable>> freeVariables(new std::set<Variable>);
+    std::vector<Variable> result;
 
-        switch (symbol.type) {
-        case NONE_SYMBOL: case FALSE_SYMBOL: case TRUE_SYMBOL: case CONSTANT:
-            break;
+    for (const_iterator i = cbegin(); i != cend(); ++i) {
+        if (std::find(variables.cbegin(), variables.cend(), *i) == variables.cend()) {
+            result.push_back(*i);
+        }
+    }
 
-        case VARIABLE:
-            freeVariables->insert(symbol);
+    return VariableSet(std::move(result));
+}
 
-            break;
+uint64_t VariableSet::signature(const Variable &variable)
+{
+    return uint64_t(1) << (variable.id % 64);
+}
 
-        case OPERATION:
-            for (size_t i = 0; i < args.size(); ++i) {
-                const std::set<Variable> variables = args[i].getFreeVariables();
+uint32_t Fingerprint::code(const Symbol &symbol)
+{
+    if (symbol.type == VARIABLE) {
+        return variable;
+    }
 
-                freeVariables->insert(variables.cbegin(), variables.cend());
-            }
+    uint32_t result = uint32_t(symbol.id ^ (symbol.id >> 32));
 
-            break;
-        default:
-            throw(1);
+    return result > belowVariable ? result : result + belowVariable + 1;
+}
 
-            break;
-        }
+// Written without branches over all positions, so that the loop is
+// vectorized by the compiler.
+bool Fingerprint::unifiable(const Fingerprint &other) const
+{
+    uint32_t result = 1;
 
-        this->freeVariables = freeVariables;
+    for (std::size_t i = 0; i < size; ++i) {
+        uint32_t a = data[i];
+        uint32_t b = other.data[i];
+
+        result &= (a == b) | (a == belowVariable) | (b == belowVariable) |
+                  ((a == variable) & (b != absent)) | ((b == variable) & (a != absent));
     }
 
-    return *freeVariables;
+    return result != 0;
 }
 
-TermEnvironment::EmptyTermPrivate::EmptyTermPrivate() :
-    TermPrivate(Symbol::dummy())
+TermEnvironment::TermPrivate::TermPrivate(Symbol symbol) :
+    symbol(symbol),
+    args(),
+    hashValue(hashOf(this->symbol, this->args)),
+    fingerprint(fingerprintOf(this->symbol, this->args)),
+    serial(nextSerial()),
+    freeVariables()
 {
 }
 
-TermEnvironment::VariableTermPrivate::VariableTermPrivate(const Variable &variable) :
-    TermPrivate(variable)
+TermEnvironment::TermPrivate::TermPrivate(Symbol symbol, const std::vector<Term> &args) :
+    symbol(symbol),
+    args(args),
+    hashValue(hashOf(this->symbol, this->args)),
+    fingerprint(fingerprintOf(this->symbol, this->args)),
+    serial(nextSerial()),
+    freeVariables()
 {
+    if (args.size() != symbol.arity) {
+        throw(0);
+    }
 }
 
-TermEnvironment::ConstantTermPrivate::ConstantTermPrivate(const ConstantSymbol &constant) :
-    TermPrivate(constant)
+TermEnvironment::TermPrivate::TermPrivate(Symbol symbol, std::vector<Term> &&args) :
+    symbol(symbol),
+    args(std::move(args)),
+    hashValue(hashOf(this->symbol, this->args)),
+    fingerprint(fingerprintOf(this->symbol, this->args)),
+    serial(nextSerial()),
+    freeVariables()
 {
+    if (this->args.size() != symbol.arity) {
+        throw(0);
+    }
 }
 
-TermEnvironment::OperationTermPrivate::OperationTermPrivate(const OperationSymbol &operation, const std::vector<Term> &args) :
-    TermPrivate(operation, args)
+TermEnvironment::TermPrivate::TermPrivate(const TermPrivate &other) :
+    symbol(other.symbol),
+    args(other.args),
+    hashValue(hashOf(this->symbol, this->args)),
+    fingerprint(fingerprintOf(this->symbol, this->args)),
+    serial(nextSerial()),
+    freeVariables()
 {
 }
 
-TermEnvironment::OperationTermPrivate::OperationTermPrivate(const OperationSymbol &operation, std::vector<Term> &&args) :
-    TermPrivate(operation, std::move(args))
+TermEnvironment::TermPrivate::TermPrivate(TermPrivate &&other) :
+    symbol(other.symbol),
+    args(std::move(other.args)),
+    hashValue(hashOf(this->symbol, this->args)),
+    fingerprint(fingerprintOf(this->symbol, this->args)),
+    serial(nextSerial()),
+    freeVariables()
 {
 }
 
-TermEnvironment::Substitution::Substitution()
+// Promoted copy of other with the given arguments, equal to other.
+TermEnvironment::TermPrivate::TermPrivate(const TermPrivate &other, std::vector<Term> &&args) :
+    symbol(other.symbol),
+    args(std::move(args)),
+    hashValue(other.hashValue),
+    fingerprint(other.fingerprint),
+    serial(other.serial),
+    freeVariables()
 {
 }
 
-TermEnvironment::Substitution::Substitution(const std::map<Variable, Term> &valuation) :
-    data(valuation)
+void* TermEnvironment::TermPrivate::operator new(std::size_t size)
 {
+    return NodeArena::allocate(size);
 }
 
-TermEnvironment::Substitution::Substitution(std::map<Variable, Term> &&valuation) :
-    data(valuation)
+void TermEnvironment::TermPrivate::operator delete(void *pointer)
 {
+    NodeArena::deallocate(pointer);
 }
 
-TermEnvironment::Substitution::Substitution(const Variable &variable, const Term &term) :
-    data(([](const Variable &variable, const Term &term) -> std::map<Variable, Term> {
-        std::map<Variable, Term> result;
+uint64_t TermEnvironment::TermPrivate::nextSerial()
+{
+    static std::atomic<uint64_t> counter;
 
-        result.insert(std::pair<Variable, Term>(variable, term));
+    return ++counter;
+}
 
-        return result;
-    })(variable, term))
+// Shards are chosen by the highest bits of the hash, the lowest ones choose
+// buckets inside a shard.
+TermEnvironment::TermPrivate::Shard& TermEnvironment::TermPrivate::shard(size_t hash)
 {
+    // Never destroyed, because terms can outlive static objects.
+    static Shard *result = new Shard[std::size_t(1) << shardBits];
+
+    return result[hash >> (8 * sizeof(size_t) - shardBits)];
 }
 
-TermEnvironment::Term TermEnvironment::Substitution::operator ()(const Variable &variable) const
+// Must be called with the mutex of the shard locked.
+std::shared_ptr<TermEnvironment::TermPrivate> TermEnvironment::TermPrivate::lookup(Shard &shard, const TermPrivate &term)
 {
-    std::map<Variable, Term>::const_iterator i = data.find(variable);
+    auto range = shard.nodes.equal_range(term.hashValue);
 
-    if (i != data.cend()) {
-        return i->second;
+    for (auto i = range.first; i != range.second; ++i) {
+        if (i->second.first->equals(term.symbol, term.args)) {
+            std::shared_ptr<TermPrivate> result = i->second.second.lock();
+
+            if ((bool)result) {
+                return result;
+            }
+        }
     }
 
-    return Term(variable);
+    return std::shared_ptr<TermPrivate>();
 }
 
-Substitution Substitution::operator [](const Substitution &other) const
+// No deleter may run while the mutex of a shard is locked, because release
+// locks it again. So the candidate is owned by a shared pointer only after
+// the first lookup fails, with the mutex unlocked, and shared pointers are
+// released after unlocking. While no arena is active the result is
+// promoted.
+std::shared_ptr<TermEnvironment::TermPrivate> TermEnvironment::TermPrivate::intern(TermPrivate *term)
 {
-    std::map<Variable, Term> result;
+    std::unique_ptr<TermPrivate> candidate(term);
+    Shard &s = shard(term->hashValue);
+    std::shared_ptr<TermPrivate> result;
 
-    for (std::map<Variable, Term>::const_iterator i = other.data.cbegin(); i!=other.data.cend(); ++i) {
-        Variable x = i->first;
-        Term t = i->second;
-        Term r = t[*this];
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
 
-        result.insert(std::pair<Variable, Term>(x, r));
+        result = lookup(s, *term);
     }
 
-    for (std::map<Variable, Term>::const_iterator i = data.cbegin(); i!=data.cend(); ++i) {
-        if (other.data.find(i->first)==other.data.end()) {
-            result.insert(*i);
+    if ((bool)result == false) {
+        std::shared_ptr<TermPrivate> fresh(candidate.release(), release, NodeAllocator<TermPrivate>());
+
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+
+            result = lookup(s, *fresh);
+
+            if ((bool)result == false) {
+                s.nodes.emplace(fresh->hashValue, std::make_pair(fresh.get(), std::weak_ptr<TermPrivate>(fresh)));
+                result = fresh;
+            }
         }
     }
 
+    if (NodeArena::active() == nullptr) {
+        return promote(result);
+    }
+
     return result;
 }
 
-TermEnvironment::Term::Term() :
-    term(TermPrivate::dummy())
+// Whether term and it's arguments were allocated while no arena was active.
+// Arguments of such a term in the table are persistent themselves.
+bool TermEnvironment::TermPrivate::settled(const std::shared_ptr<TermPrivate> &term)
 {
-}
+    if ((bool)term == false) {
+        return true;
+    }
 
-TermEnvironment::Term::Term(const Term &other) :
-    termPtr(other.termPtr),
-    term(other.term)
-{
-}
+    if (NodeArena::persistent(term.get()) == false) {
+        return false;
+    }
 
-TermEnvironment::Term::Term(const Variable &variable) :
-    termPtr(new VariableTermPrivate(variable)),
-    term(*termPtr)
-{
-}
+    for (auto i = term->args.cbegin(); i != term->args.cend(); ++i) {
+        if ((bool)i->termPtr && NodeArena::persistent(i->termPtr.get()) == false) {
+            return false;
+        }
+    }
 
-TermEnvironment::Term::Term(const ConstantSymbol &constantSymbol) :
-    termPtr(new ConstantTermPrivate(constantSymbol)),
-    term(*termPtr)
-{
+    return true;
 }
 
-TermEnvironment::Term::Term(const OperationSymbol &operationSymbol, const std::vector<Term> &args) :
-    termPtr(new OperationTermPrivate(operationSymbol, args)),
-    term(*termPtr)
+// Returns term if it is settled, otherwise a copy of it allocated outside
+// of arenas, which replaces term in the table. Term stays valid for it's
+// owners, equal to the copy, and keeps the copy alive.
+std::shared_ptr<TermEnvironment::TermPrivate> TermEnvironment::TermPrivate::promote(const std::shared_ptr<TermPrivate> &term)
 {
-}
+    if (settled(term)) {
+        return term;
+    }
 
-TermEnvironment::Term::Term(const OperationSymbol &operationSymbol, std::vector<Term> &&args) :
-    termPtr(new OperationTermPrivate(operationSymbol, args)),
-    term(*termPtr)
-{
-}
+    NodeArena::Heap heap;
+    std::vector<Term> args;
 
-bool TermEnvironment::Term::operator ==(const Term &other) const
-{
-    return term == other.term;
-}
+    args.reserve(term->args.size());
 
-bool TermEnvironment::Term::operator !=(const Term &other) const
-{
-    return operator ==(other) == false;
-}
+    for (auto i = term->args.cbegin(); i != term->args.cend(); ++i) {
+        args.push_back(i->persistent());
+    }
 
-int TermEnvironment::Term::compare(const Term &other) const
-{
-    return term.compare(other.term);
-}
+    std::shared_ptr<TermPrivate> copy(new TermPrivate(*term, std::move(args)), release, NodeAllocator<TermPrivate>());
+    std::shared_ptr<TermPrivate> other;
+    Shard &s = shard(term->hashValue);
 
-bool TermEnvironment::Term::operator <(const Term &other) const
-{
-    return term.compare(other.term) < 0;
-}
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto range = s.nodes.equal_range(term->hashValue);
 
-size_t TermEnvironment::Term::hash() const
-{
-    return term.hash();
-}
+        for (auto i = range.first; i != range.second; ++i) {
+            if (i->second.first->serial == term->serial) {
+                other = i->second.second.lock();
 
-SymbolType TermEnvironment::Term::type() const
-{
-    return term.symbol.type;
-}
+                if ((bool)other && other != term && settled(other)) {
+                    return other;
+                }
+
+                i->second = std::make_pair(copy.get(), std::weak_ptr<TermPrivate>(copy));
+                term->promoted = copy;
+
+                return copy;
+            }
+        }
+
+        s.nodes.emplace(copy->hashValue, std::make_pair(copy.get(), std::weak_ptr<TermPrivate>(copy)));
+    }
+
+    return copy;
+}
+
+// Also called for a candidate which was never put in the table.
+void TermEnvironment::TermPrivate::release(TermPrivate *term)
+{
+    Shard &s = shard(term->hashValue);
+
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto range = s.nodes.equal_range(term->hashValue);
+
+        for (auto i = range.first; i != range.second; ++i) {
+            if (i->second.first == term) {
+                s.nodes.erase(i);
+
+                break;
+            }
+        }
+    }
+
+    delete term;
+}
+
+const TermEnvironment::TermPrivate& TermEnvironment::TermPrivate::dummy()
+{
+    thread_local static EmptyTermPrivate result;
+
+    return result;
+}
+
+size_t TermEnvironment::TermPrivate::hashOf(const Symbol &symbol, const std::vector<Term> &args)
+{
+    size_t result = hashCombine(symbol.type, symbol.id);
+
+    for (size_t i = 0; i < args.size(); ++i) {
+        result = hashCombine(result, args[i].hash());
+    }
+
+    return result;
+}
+
+Fingerprint TermEnvironment::TermPrivate::fingerprintOf(const Symbol &symbol, const std::vector<Term> &args)
+{
+    Fingerprint result;
+
+    result.data[0] = Fingerprint::code(symbol);
+
+    for (size_t i = 1; i < Fingerprint::size; ++i) {
+        result.data[i] = symbol.type == VARIABLE ? Fingerprint::belowVariable : Fingerprint::absent;
+    }
+
+    for (size_t i = 0; i < 3 && i < args.size(); ++i) {
+        result.data[1 + i] = args[i].fingerprint().data[0];
+    }
+
+    for (size_t i = 0; i < 2 && i < args.size(); ++i) {
+        result.data[4 + 2 * i] = args[i].fingerprint().data[1];
+        result.data[5 + 2 * i] = args[i].fingerprint().data[2];
+    }
+
+    return result;
+}
+
+bool TermEnvironment::TermPrivate::equals(const Symbol &symbol, const std::vector<Term> &args) const
+{
+    if (this->symbol != symbol || this->args.size() != args.size()) {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        if (this->args[i].term.serial != args[i].term.serial) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool TermEnvironment::TermPrivate::operator ==(const TermPrivate &other) const
+{
+    return serial == other.serial;
+}
+
+bool TermEnvironment::TermPrivate::operator !=(const TermPrivate &other) const
+{
+    return serial != other.serial;
+}
+
+// Structural order, so that it does not depend on the order in which
+// internal objects were created. Equal terms share the internal object, so
+// the comparison stops at the first shared subterm.
+int TermEnvironment::TermPrivate::compare(const TermPrivate &other) const
+{
+    if (serial == other.serial) {
+        return 0;
+    }
+
+    int result = symbol.compare(other.symbol);
+
+    if (result != 0) {
+        return result;
+    }
+
+    if (args.size() != other.args.size()) {
+        return (args.size() < other.args.size()) ? -1 : 1;
+    }
+
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        result = args[i].compare(other.args[i]);
+
+        if (result != 0) {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+bool TermEnvironment::TermPrivate::operator <(const TermPrivate &other) const
+{
+   return compare(other) < 0;
+}
+
+size_t TermEnvironment::TermPrivate::hash() const
+{
+    return hashValue;
+}
+
+bool TermEnvironment::TermPrivate::isFreeVariable(const Variable &variable) const
+{
+    return getFreeVariables().count(variable) > 0;
+}
+
+VariableSet TermEnvironment::TermPrivate::computeFreeVariables() const
+{
+    VariableSet result;
+
+    switch (symbol.type) {
+    case NONE_SYMBOL: case FALSE_SYMBOL: case TRUE_SYMBOL: case CONSTANT:
+        break;
+
+    case VARIABLE:
+        result = VariableSet(symbol);
+
+        break;
+
+    case OPERATION:
+        for (size_t i = 0; i < args.size(); ++i) {
+            result = result.unite(args[i].getFreeVariables());
+        }
+
+        break;
+    default:
+        throw(1);
+
+        break;
+    }
+
+    return result;
+}
+
+const VariableSet& TermEnvironment::TermPrivate::getFreeVariables() const
+{
+    std::call_once(freeVariablesFlag, [this]() {
+        freeVariables = computeFreeVariables();
+    });
+
+    return freeVariables;
+}
+
+TermEnvironment::EmptyTermPrivate::EmptyTermPrivate() :
+    TermPrivate(Symbol::dummy())
+{
+}
+
+TermEnvironment::VariableTermPrivate::VariableTermPrivate(const Variable &variable) :
+    TermPrivate(variable)
+{
+}
+
+TermEnvironment::ConstantTermPrivate::ConstantTermPrivate(const ConstantSymbol &constant) :
+    TermPrivate(constant)
+{
+}
+
+TermEnvironment::OperationTermPrivate::OperationTermPrivate(const OperationSymbol &operation, const std::vector<Term> &args) :
+    TermPrivate(operation, args)
+{
+}
+
+TermEnvironment::OperationTermPrivate::OperationTermPrivate(const OperationSymbol &operation, std::vector<Term> &&args) :
+    TermPrivate(operation, std::move(args))
+{
+}
+
+std::vector<std::pair<Variable, TermEnvironment::Term>> TermEnvironment::Substitution::fromMap(const std::map<Variable, Term> &valuation)
+{
+    std::vector<std::pair<Variable, Term>> result;
+
+    result.reserve(valuation.size());
+
+    for (std::map<Variable, Term>::const_iterator i = valuation.cbegin(); i != valuation.cend(); ++i) {
+        result.push_back(*i);
+    }
+
+    return result;
+}
+
+uint64_t TermEnvironment::Substitution::signatureOf(const std::vector<std::pair<Variable, Term>> &data)
+{
+    uint64_t result = 0;
+
+    for (size_t i = 0; i < data.size(); ++i) {
+        result |= VariableSet::signature(data[i].first);
+    }
+
+    return result;
+}
+
+TermEnvironment::Substitution::Substitution(std::vector<std::pair<Variable, Term>> &&data) :
+    data(std::move(data)),
+    mask(signatureOf(this->data))
+{
+}
+
+TermEnvironment::Substitution::Substitution() :
+    mask(0)
+{
+}
+
+TermEnvironment::Substitution::Substitution(const std::map<Variable, Term> &valuation) :
+    data(fromMap(valuation)),
+    mask(signatureOf(data))
+{
+}
+
+TermEnvironment::Substitution::Substitution(std::map<Variable, Term> &&valuation) :
+    data(fromMap(valuation)),
+    mask(signatureOf(data))
+{
+}
+
+TermEnvironment::Substitution::Substitution(const Variable &variable, const Term &term) :
+    data(1, std::pair<Variable, Term>(variable, term)),
+    mask(VariableSet::signature(variable))
+{
+}
+
+TermEnvironment::Substitution::Substitution(const Substitution &other) :
+    data(other.data),
+    mask(other.mask)
+{
+}
+
+const TermEnvironment::Term* TermEnvironment::Substitution::find(const Variable &variable) const
+{
+    if ((mask & VariableSet::signature(variable)) == 0) {
+        return nullptr;
+    }
+
+    size_t begin = 0;
+    size_t end = data.size();
+
+    while (begin < end) {
+        size_t middle = begin + (end - begin) / 2;
+
+        if (data[middle].first.id < variable.id) {
+            begin = middle + 1;
+        } else {
+            end = middle;
+        }
+    }
+
+    if (begin < data.size() && data[begin].first == variable) {
+        return &data[begin].second;
+    }
+
+    return nullptr;
+}
+
+bool TermEnvironment::Substitution::affects(const VariableSet &variables) const
+{
+    if ((mask & variables.signature()) == 0) {
+        return false;
+    }
+
+    for (VariableSet::const_iterator i = variables.cbegin(); i != variables.cend(); ++i) {
+        if (find(*i) != nullptr) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool TermEnvironment::Substitution::empty() const
+{
+    return data.empty();
+}
+
+size_t TermEnvironment::Substitution::size() const
+{
+    return data.size();
+}
+
+TermEnvironment::Term TermEnvironment::Substitution::operator ()(const Variable &variable) const
+{
+    const Term *result = find(variable);
+
+    if (result != nullptr) {
+        return *result;
+    }
+
+    return Term(variable);
+}
+
+Substitution Substitution::operator [](const Substitution &other) const
+{
+    std::vector<std::pair<Variable, Term>> result;
+    size_t i = 0;
+    size_t j = 0;
+
+    result.reserve(data.size() + other.data.size());
+
+    // Both arrays are sorted, so the composition is merged in one pass.
+    // Terms of other that do not contain any variable of this substitution
+    // are taken as they are.
+    while (i < data.size() || j < other.data.size()) {
+        if (j == other.data.size() || (i < data.size() && data[i].first.id < other.data[j].first.id)) {
+            result.push_back(data[i]);
+            ++i;
+
+            continue;
+        }
+
+        if (i < data.size() && data[i].first == other.data[j].first) {
+            ++i;
+        }
+
+        const Term &t = other.data[j].second;
+
+        if (affects(t.getFreeVariables())) {
+            result.push_back(std::pair<Variable, Term>(other.data[j].first, t[*this]));
+        } else {
+            result.push_back(other.data[j]);
+        }
+
+        ++j;
+    }
+
+    return Substitution(std::move(result));
+}
+
+TermEnvironment::Term::Term() :
+    term(TermPrivate::dummy())
+{
+}
+
+TermEnvironment::Term::Term(const Term &other) :
+    termPtr(other.termPtr),
+    term(other.term)
+{
+}
+
+TermEnvironment::Term::Term(const Variable &variable) :
+    termPtr(TermPrivate::intern(new VariableTermPrivate(variable))),
+    term(*termPtr)
+{
+}
+
+TermEnvironment::Term::Term(const ConstantSymbol &constantSymbol) :
+    termPtr(TermPrivate::intern(new ConstantTermPrivate(constantSymbol))),
+    term(*termPtr)
+{
+}
+
+TermEnvironment::Term::Term(const std::shared_ptr<TermPrivate> &termPtr) :
+    termPtr(termPtr),
+    term(*termPtr)
+{
+}
+
+TermEnvironment::Term::Term(const OperationSymbol &operationSymbol, const std::vector<Term> &args) :
+    termPtr(TermPrivate::intern(new OperationTermPrivate(operationSymbol, args))),
+    term(*termPtr)
+{
+}
+
+TermEnvironment::Term::Term(const OperationSymbol &operationSymbol, std::vector<Term> &&args) :
+    termPtr(TermPrivate::intern(new OperationTermPrivate(operationSymbol, std::move(args)))),
+    term(*termPtr)
+{
+}
+
+bool TermEnvironment::Term::operator ==(const Term &other) const
+{
+    return term.serial == other.term.serial;
+}
+
+bool TermEnvironment::Term::operator !=(const Term &other) const
+{
+    return term.serial != other.term.serial;
+}
+
+int TermEnvironment::Term::compare(const Term &other) const
+{
+    return term.compare(other.term);
+}
+
+bool TermEnvironment::Term::operator <(const Term &other) const
+{
+    return term.compare(other.term) < 0;
+}
+
+size_t TermEnvironment::Term::hash() const
+{
+    return term.hash();
+}
+
+SymbolType TermEnvironment::Term::type() const
+{
+    return term.symbol.type;
+}
+
+const Fingerprint& TermEnvironment::Term::fingerprint() const
+{
+    return term.fingerprint;
+}
 
 uint64_t TermEnvironment::Term::id() const
 {
     return term.symbol.id;
 }
 
+uint64_t TermEnvironment::Term::serial() const
+{
+    return term.serial;
+}
+
 const Symbol& TermEnvironment::Term::symbol() const
 {
     return term.symbol;
@@ -703,16 +1233,37 @@ bool TermEnvironment::Term::isFreeVariable(const Variable &variable) const
     return term.isFreeVariable(variable);
 }
 
-const std::set<Variable>& TermEnvironment::Term::getFreeVariables() const
+const VariableSet& TermEnvironment::Term::getFreeVariables() const
 {
     return term.getFreeVariables();
 }
 
+bool TermEnvironment::Term::isGround() const
+{
+    return term.getFreeVariables().empty();
+}
+
 bool TermEnvironment::Term::isEmpty() const
 {
     return false;
 }
 
+bool TermEnvironment::Term::isPersistent() const
+{
+    return TermPrivate::settled(termPtr);
+}
+
+// The term itself if it is persistent, otherwise it's copy allocated
+// outside of arenas.
+TermEnvironment::Term TermEnvironment::Term::persistent() const
+{
+    if ((bool)termPtr == false) {
+        return *this;
+    }
+
+    return Term(TermPrivate::promote(termPtr));
+}
+
 TermEnvironment::Term TermEnvironment::Term::operator [](const Substitution &valuation) const
 {
     if (isEmpty()) {
@@ -726,195 +1277,535 @@ TermEnvironment::Term TermEnvironment::Term::operator [](const Substitution &val
         break;
 
     case VARIABLE:
-        return valuation(term.symbol);
+    {
+        const Term *result = valuation.find(term.symbol);
+
+        return result == nullptr ? *this : *result;
+
+        break;
+    }
+
+    case OPERATION:
+        {
+            // Subterms without substituted variables are shared, not rebuilt.
+            if (!valuation.affects(getFreeVariables())) {
+                return *this;
+            }
+
+            std::vector<Term> args;
+
+            for (size_t i = 0; i < term.args.size(); ++i) {
+                args.push_back(term.args[i][valuation]);
+            }
+
+            return Term(term.symbol, std::move(args));
+
+            break;
+        }
+    default:
+        throw(0);
 
         break;
+    }
+}
+
+const TermEnvironment::Term& TermEnvironment::Term::dummy()
+{
+    thread_local static Term result;
+
+    return result;
+}
+
+std::vector<Variable> TermEnvironment::oneVariable(const Variable &variable)
+{
+    std::vector<Variable> result;
+
+    result.push_back(variable);
+
+    return result;
+}
+
+std::vector<TermEnvironment::Term> TermEnvironment::oneTerm(const TermEnvironment::Term &term)
+{
+    std::vector<Term> result;
+
+    result.push_back(term);
+
+    return result;
+}
+
+std::vector<TermEnvironment::Term> TermEnvironment::twoTerms(const TermEnvironment::Term &term1, const TermEnvironment::Term &term2)
+{
+    std::vector<Term> result;
+
+    result.push_back(term1);
+    result.push_back(term2);
+
+    return result;
+}
+
+Substitution TermEnvironment::naiveUnificator(std::vector<std::pair<Term, Term>> &conditions, bool &ok)
+{
+    std::unique_ptr<Substitution> result(new Substitution);
+
+    while (conditions.empty()==false) {
+        const std::pair<Term, Term> &p = conditions[conditions.size()-1];
+        const Term u = p.first;
+        const Term v = p.second;
+
+        if (u==v) {
+            conditions.pop_back();
+
+            continue;
+        }
+
+        if (u.type()==VARIABLE || v.type()==VARIABLE) {
+            const Term *variable;
+            const Term *t;
+
+            if (u.type()==VARIABLE) {
+                variable = &u;
+                t = &v;
+            } else {
+                variable = &v;
+                t = &u;
+            }
+
+            const Variable var(variable->symbol());
+            const Variable *x = &var;
+
+            if (t->isFreeVariable(*x)) {
+                ok = false;
+
+                return Substitution();
+            }
+
+            conditions.pop_back();
+
+            std::vector<std::pair<Term, Term>> oldConditions(std::move(conditions));
+
+            conditions.clear();
+
+            Substitution sub(*x, *t);
+
+            for (size_t i = 0; i<oldConditions.size(); ++i) {
+                auto p = oldConditions[i];
+                auto v = p.first;
+                auto t = p.second;
+
+                conditions.push_back(std::pair<Term, Term>(v[sub], t[sub]));
+            }
+
+            result.reset(new Substitution(sub[*result]));
+
+            continue;
+        }
+
+        if ((u.type()==CONSTANT || v.type()==CONSTANT) || (u.symbol()!=v.symbol())) {
+            ok = false;
+
+            return Substitution();
+        }
+
+        conditions.pop_back();
+
+        size_t size = u.arity();
+
+        if (size!=v.arity() || size!=u.args().size() || size!=v.args().size()) {
+            throw(1);
+        }
+
+        for (size_t i = 0; i<size; ++i) {
+            conditions.push_back(std::pair<Term, Term>(u.args()[i], v.args()[i]));
+        }
+    }
+
+    ok = true;
+
+    return *result;
+}
+
+Substitution TermEnvironment::naiveUnificator(const Term &t1, const Term &t2, bool &ok)
+{
+    std::vector<std::pair<Term, Term>> v;
+
+    v.push_back(std::pair<Term, Term>(t1, t2));
+
+    return naiveUnificator(v, ok);
+}
+
+Substitution TermEnvironment::unificator(const std::vector<std::pair<Term, Term>> &conditions, bool &ok)
+{
+    UnificationGraph graph;
+
+    for (size_t i = 0; i < conditions.size(); ++i) {
+        if (!conditions[i].first.fingerprint().unifiable(conditions[i].second.fingerprint())) {
+            ok = false;
+
+            return Substitution();
+        }
+    }
+
+    for (size_t i = 0; i < conditions.size(); ++i) {
+        if (!graph.unify(conditions[i].first, conditions[i].second)) {
+            ok = false;
+
+            return Substitution();
+        }
+    }
+
+    return graph.unificator(ok);
+}
+
+Substitution TermEnvironment::unificator(const Term &t1, const Term &t2, bool &ok)
+{
+    if (!t1.fingerprint().unifiable(t2.fingerprint())) {
+        ok = false;
+
+        return Substitution();
+    }
+
+    UnificationGraph graph;
+
+    if (!graph.unify(t1, t2)) {
+        ok = false;
+
+        return Substitution();
+    }
+
+    return graph.unificator(ok);
+}
+
+// Later bindings shadow earlier ones, which is used for bound variables
+// when matching formulas.
+const TermEnvironment::Term* TermEnvironment::binding(const Variable &variable, const std::vector<std::pair<Variable, Term>> &bindings)
+{
+    for (size_t i = bindings.size(); i > 0; --i) {
+        if (bindings[i-1].first == variable) {
+            return &bindings[i-1].second;
+        }
+    }
+
+    return nullptr;
+}
+
+// Binds variables of pattern only, so that pattern[bindings] == target.
+// New bindings are appended; on failure bindings are left as they were.
+bool TermEnvironment::match(const Term &pattern, const Term &target, std::vector<std::pair<Variable, Term>> &bindings)
+{
+    size_t size = bindings.size();
+
+    switch (pattern.type()) {
+    case VARIABLE:
+    {
+        const Term *t = binding(Variable(pattern.symbol()), bindings);
+
+        if (t != nullptr) {
+            return *t == target;
+        }
+
+        bindings.push_back(std::pair<Variable, Term>(Variable(pattern.symbol()), target));
+
+        return true;
+    }
 
     case OPERATION:
-        {
-            std::vector<Term> args;
+        if (pattern.isGround()) {
+            return pattern == target;
+        }
 
-            for (size_t i = 0; i < term.args.size(); ++i) {
-                args.push_back(term.args[i][valuation]);
-            }
+        if (target.type() != OPERATION || pattern.symbol() != target.symbol() || pattern.args().size() != target.args().size()) {
+            return false;
+        }
 
-            return Term(term.symbol, std::move(args));
+        for (size_t i = 0; i < pattern.args().size(); ++i) {
+            if (!match(pattern.args()[i], target.args()[i], bindings)) {
+                while (bindings.size() > size) {
+                    bindings.pop_back();
+                }
 
-            break;
+                return false;
+            }
         }
-    default:
-        throw(0);
 
-        break;
+        return true;
+
+    default:
+        return pattern == target;
     }
 }
 
-const TermEnvironment::Term& TermEnvironment::Term::dummy()
+Substitution TermEnvironment::matcher(const Term &pattern, const Term &target, bool &ok)
 {
-    thread_local static Term result;
+    std::vector<std::pair<Variable, Term>> bindings;
 
-    return result;
+    ok = match(pattern, target, bindings);
+
+    if (!ok) {
+        return Substitution();
+    }
+
+    return Substitution(std::map<Variable, Term>(bindings.cbegin(), bindings.cend()));
 }
 
-std::vector<Variable> TermEnvironment::oneVariable(const Variable &variable)
+size_t TermEnvironment::UnificationGraph::node(const Term &term)
 {
-    std::vector<Variable> result;
+    std::unordered_map<uint64_t, size_t>::const_iterator i = index.find(term.serial());
 
-    result.push_back(variable);
+    if (i != index.cend()) {
+        return i->second;
+    }
+
+    size_t result = nodes.size();
+
+    index.insert(std::pair<uint64_t, size_t>(term.serial(), result));
+    nodes.push_back(term);
+    parent.push_back(result);
+    rank.push_back(0);
+    schema.push_back(result);
+    state.push_back(0);
 
     return result;
 }
 
-std::vector<TermEnvironment::Term> TermEnvironment::oneTerm(const TermEnvironment::Term &term)
+size_t TermEnvironment::UnificationGraph::find(size_t i)
 {
-    std::vector<Term> result;
-
-    result.push_back(term);
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
 
-    return result;
+    return i;
 }
 
-std::vector<TermEnvironment::Term> TermEnvironment::twoTerms(const TermEnvironment::Term &term1, const TermEnvironment::Term &term2)
+void TermEnvironment::UnificationGraph::link(size_t i, size_t j, size_t newSchema)
 {
-    std::vector<Term> result;
+    if (rank[i] < rank[j]) {
+        std::swap(i, j);
+    }
 
-    result.push_back(term1);
-    result.push_back(term2);
+    if (rank[i] == rank[j]) {
+        ++rank[i];
+    }
 
-    return result;
+    parent[j] = i;
+    schema[i] = newSchema;
 }
 
-Substitution TermEnvironment::unificator(std::vector<std::pair<Term, Term>> &conditions, bool &ok)
+bool TermEnvironment::UnificationGraph::unify(const Term &t1, const Term &t2)
 {
-    std::map<Variable, Term> result;
+    std::vector<std::pair<size_t, size_t>> stack;
 
-    while (conditions.empty()==false) {
-        const std::pair<Term, Term> &p = conditions[conditions.size()-1];
-        const Term u = p.first;
-        const Term v = p.second;
+    stack.push_back(std::pair<size_t, size_t>(node(t1), node(t2)));
 
-        if (u==v) {
-            conditions.pop_back();
+    while (!stack.empty()) {
+        size_t i = find(stack.back().first);
+        size_t j = find(stack.back().second);
 
+        stack.pop_back();
+
+        if (i == j) {
             continue;
         }
 
-        if (u.type()==VARIABLE || v.type()==VARIABLE) {
-            const Term *variable;
-            const Term *t;
+        const Term u(nodes[schema[i]]);
+        const Term v(nodes[schema[j]]);
 
-            if (u.type()==VARIABLE) {
-                variable = &u;
-                t = &v;
-            } else {
-                variable = &v;
-                t = &u;
-            }
+        if (u.type() == VARIABLE) {
+            link(i, j, schema[j]);
 
-            const Variable var(variable->symbol());
-            const Variable *x = &var;
+            continue;
+        }
 
-            if (t->isFreeVariable(*x)) {
-                ok = false;
-                result.clear();
+        if (v.type() == VARIABLE) {
+            link(i, j, schema[i]);
 
-                return result;
-            }
+            continue;
+        }
 
-            conditions.pop_back();
+        if ((u.type() == CONSTANT || v.type() == CONSTANT) || (u.symbol() != v.symbol())) {
+            return false;
+        }
 
-            std::vector<std::pair<Term, Term>> oldConditions(std::move(conditions));
+        size_t size = u.arity();
 
-            conditions.clear();
+        if (size != v.arity() || size != u.args().size() || size != v.args().size()) {
+            throw(1);
+        }
 
-            std::map<Variable, Term> s;
+        link(i, j, schema[i]);
 
-            s.insert(std::pair<Variable, Term>(*x, *t));
+        for (size_t k = 0; k < size; ++k) {
+            stack.push_back(std::pair<size_t, size_t>(node(u.args()[k]), node(v.args()[k])));
+        }
+    }
 
-            Substitution sub(s);
+    return true;
+}
 
-            for (size_t i = 0; i<oldConditions.size(); ++i) {
-                auto p = oldConditions[i];
-                auto v = p.first;
-                auto t = p.second;
+// Builds the term of the class of i with every class replaced by its
+// schema. Reaching a class still under construction means the schemas
+// are cyclic, i.e. the occurs check fails.
+bool TermEnvironment::UnificationGraph::resolve(size_t i)
+{
+    size_t r = find(i);
 
-                conditions.push_back(std::pair<Term, Term>(v[sub], t[sub]));
-            }
+    if (state[r] == 2) {
+        return true;
+    }
+
+    if (state[r] == 1) {
+        return false;
+    }
 
-            result = Substitution(*x, *t)[result].data;
+    state[r] = 1;
 
-            continue;
-        }
+    const Term t(nodes[schema[r]]);
 
-        if ((u.type()==CONSTANT || v.type()==CONSTANT) || (u.symbol()!=v.symbol())) {
-            ok = false;
-            result.clear();
+    if (t.type() != OPERATION) {
+        resolved.insert(std::pair<size_t, Term>(r, t));
+        state[r] = 2;
 
-            return result;
-        }
+        return true;
+    }
 
-        conditions.pop_back();
+    std::vector<Term> args;
+    bool changed = false;
 
-        size_t size = u.arity();
+    for (size_t k = 0; k < t.args().size(); ++k) {
+        size_t a = node(t.args()[k]);
 
-        if (size!=v.arity() || size!=u.args().size() || size!=v.args().size()) {
-            throw(1);
+        if (!resolve(a)) {
+            return false;
         }
 
-        for (size_t i = 0; i<size; ++i) {
-            conditions.push_back(std::pair<Term, Term>(u.args()[i], v.args()[i]));
-        }
+        const Term &u = resolved.at(find(a));
+
+        changed = changed || u != t.args()[k];
+        args.push_back(u);
     }
 
-    ok = true;
+    if (changed) {
+        resolved.insert(std::pair<size_t, Term>(r, Term(t.symbol(), std::move(args))));
+    } else {
+        resolved.insert(std::pair<size_t, Term>(r, t));
+    }
 
-    return result;
+    state[r] = 2;
+
+    return true;
 }
 
-Substitution TermEnvironment::unificator(const Term &t1, const Term &t2, bool &ok)
+Substitution TermEnvironment::UnificationGraph::unificator(bool &ok)
 {
-    std::vector<std::pair<Term, Term>> v;
+    std::map<Variable, Term> result;
 
-    v.push_back(std::pair<Term, Term>(t1, t2));
+    // resolve() may add nodes for arguments of schemas, which are checked
+    // as well.
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (!resolve(i)) {
+            ok = false;
+
+            return Substitution();
+        }
+    }
 
-    return unificator(v, ok);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].type() != VARIABLE) {
+            continue;
+        }
+
+        const Term &t = resolved.at(find(i));
+
+        if (t != nodes[i]) {
+            result.insert(std::pair<Variable, Term>(Variable(nodes[i].symbol()), t));
+        }
+    }
+
+    ok = true;
+
+    return Substitution(std::move(result));
 }
 
 FormulaEnvironment::FormulaPrivate::FormulaPrivate() :
-    symbol(Symbol::dummy())
+    symbol(Symbol::dummy()),
+    hashValue(hashOf(this->symbol, this->terms, this->formulas, this->variables)),
+    serial(nextSerial()),
+    freeVariables(),
+    simplified(),
+    simplifiedSelf(false),
+    simplifiedReady(false),
+    uniformTypeValue(NONE_UNIFORM_TYPE),
+    uniformSelf(false)
 {
 }
 
 FormulaEnvironment::FormulaPrivate::FormulaPrivate(const Symbol &symbol) :
-    symbol(symbol)
+    symbol(symbol),
+    hashValue(hashOf(this->symbol, this->terms, this->formulas, this->variables)),
+    serial(nextSerial()),
+    freeVariables(),
+    simplified(),
+    simplifiedSelf(false),
+    simplifiedReady(false),
+    uniformTypeValue(NONE_UNIFORM_TYPE),
+    uniformSelf(false)
 {
 }
 
 FormulaEnvironment::FormulaPrivate::FormulaPrivate(const Symbol &symbol, const std::vector<Term> &terms) :
     symbol(symbol),
     terms(terms),
-    freeVariables()
+    hashValue(hashOf(this->symbol, this->terms, this->formulas, this->variables)),
+    serial(nextSerial()),
+    freeVariables(),
+    simplified(),
+    simplifiedSelf(false),
+    simplifiedReady(false),
+    uniformTypeValue(NONE_UNIFORM_TYPE),
+    uniformSelf(false)
 {
 }
 
 FormulaEnvironment::FormulaPrivate::FormulaPrivate(const Symbol &symbol, std::vector<Term> &&terms) :
     symbol(symbol),
     terms(terms),
-    freeVariables()
+    hashValue(hashOf(this->symbol, this->terms, this->formulas, this->variables)),
+    serial(nextSerial()),
+    freeVariables(),
+    simplified(),
+    simplifiedSelf(false),
+    simplifiedReady(false),
+    uniformTypeValue(NONE_UNIFORM_TYPE),
+    uniformSelf(false)
 {
 }
 
 FormulaEnvironment::FormulaPrivate::FormulaPrivate(const Symbol &symbol, const std::vector<Formula> &formulas) :
     symbol(symbol),
     formulas(formulas),
-    freeVariables()
+    hashValue(hashOf(this->symbol, this->terms, this->formulas, this->variables)),
+    serial(nextSerial()),
+    freeVariables(),
+    simplified(),
+    simplifiedSelf(false),
+    simplifiedReady(false),
+    uniformTypeValue(NONE_UNIFORM_TYPE),
+    uniformSelf(false)
 {
 }
 
 FormulaEnvironment::FormulaPrivate::FormulaPrivate(const Symbol &symbol, std::vector<Formula> &&formulas) :
     symbol(symbol),
     formulas(formulas),
-    freeVariables()
+    hashValue(hashOf(this->symbol, this->terms, this->formulas, this->variables)),
+    serial(nextSerial()),
+    freeVariables(),
+    simplified(),
+    simplifiedSelf(false),
+    simplifiedReady(false),
+    uniformTypeValue(NONE_UNIFORM_TYPE),
+    uniformSelf(false)
 {
 }
 
@@ -922,7 +1813,14 @@ FormulaEnvironment::FormulaPrivate::FormulaPrivate(const Symbol &symbol, const F
     symbol(symbol),
     formulas(oneFormula(formula)),
     variables(variables),
-    freeVariables()
+    hashValue(hashOf(this->symbol, this->terms, this->formulas, this->variables)),
+    serial(nextSerial()),
+    freeVariables(),
+    simplified(),
+    simplifiedSelf(false),
+    simplifiedReady(false),
+    uniformTypeValue(NONE_UNIFORM_TYPE),
+    uniformSelf(false)
 {
 }
 
@@ -930,7 +1828,14 @@ FormulaEnvironment::FormulaPrivate::FormulaPrivate(const Symbol &symbol, const F
     symbol(symbol),
     formulas(oneFormula(formula)),
     variables(variables),
-    freeVariables()
+    hashValue(hashOf(this->symbol, this->terms, this->formulas, this->variables)),
+    serial(nextSerial()),
+    freeVariables(),
+    simplified(),
+    simplifiedSelf(false),
+    simplifiedReady(false),
+    uniformTypeValue(NONE_UNIFORM_TYPE),
+    uniformSelf(false)
 {
 }
 
@@ -938,7 +1843,14 @@ FormulaEnvironment::FormulaPrivate::FormulaPrivate(const Symbol &symbol, const s
     symbol(symbol),
     terms(terms),
     formulas(formulas),
-    freeVariables()
+    hashValue(hashOf(this->symbol, this->terms, this->formulas, this->variables)),
+    serial(nextSerial()),
+    freeVariables(),
+    simplified(),
+    simplifiedSelf(false),
+    simplifiedReady(false),
+    uniformTypeValue(NONE_UNIFORM_TYPE),
+    uniformSelf(false)
 {
 }
 
@@ -946,7 +1858,14 @@ FormulaEnvironment::FormulaPrivate::FormulaPrivate(const Symbol &symbol, std::ve
     symbol(symbol),
     terms(terms),
     formulas(formulas),
-    freeVariables()
+    hashValue(hashOf(this->symbol, this->terms, this->formulas, this->variables)),
+    serial(nextSerial()),
+    freeVariables(),
+    simplified(),
+    simplifiedSelf(false),
+    simplifiedReady(false),
+    uniformTypeValue(NONE_UNIFORM_TYPE),
+    uniformSelf(false)
 {
 }
 
@@ -954,7 +1873,14 @@ FormulaEnvironment::FormulaPrivate::FormulaPrivate(const Symbol &symbol, std::ve
     symbol(symbol),
     terms(terms),
     formulas(formulas),
-    freeVariables()
+    hashValue(hashOf(this->symbol, this->terms, this->formulas, this->variables)),
+    serial(nextSerial()),
+    freeVariables(),
+    simplified(),
+    simplifiedSelf(false),
+    simplifiedReady(false),
+    uniformTypeValue(NONE_UNIFORM_TYPE),
+    uniformSelf(false)
 {
 }
 
@@ -962,21 +1888,266 @@ FormulaEnvironment::FormulaPrivate::FormulaPrivate(const FormulaPrivate &other)
     symbol(other.symbol),
     terms(other.terms),
     formulas(other.formulas),
-    freeVariables()
+    variables(other.variables),
+    hashValue(hashOf(this->symbol, this->terms, this->formulas, this->variables)),
+    serial(nextSerial()),
+    freeVariables(),
+    simplified(),
+    simplifiedSelf(false),
+    simplifiedReady(false),
+    uniformTypeValue(NONE_UNIFORM_TYPE),
+    uniformSelf(false)
+{
+}
+
+FormulaEnvironment::FormulaPrivate::FormulaPrivate(FormulaPrivate &&other) :
+    symbol(other.symbol),
+    terms(std::move(other.terms)),
+    formulas(std::move(other.formulas)),
+    variables(std::move(other.variables)),
+    hashValue(hashOf(this->symbol, this->terms, this->formulas, this->variables)),
+    serial(nextSerial()),
+    freeVariables(),
+    simplified(),
+    simplifiedSelf(false),
+    simplifiedReady(false),
+    uniformTypeValue(NONE_UNIFORM_TYPE),
+    uniformSelf(false)
+{
+}
+
+// Promoted copy of other with the given subobjects, equal to other.
+FormulaEnvironment::FormulaPrivate::FormulaPrivate(const FormulaPrivate &other, std::vector<Term> &&terms, std::vector<Formula> &&formulas) :
+    symbol(other.symbol),
+    terms(std::move(terms)),
+    formulas(std::move(formulas)),
+    variables(other.variables),
+    hashValue(other.hashValue),
+    serial(other.serial),
+    freeVariables(),
+    simplified(),
+    simplifiedSelf(false),
+    simplifiedReady(false),
+    uniformTypeValue(NONE_UNIFORM_TYPE),
+    uniformSelf(false)
+{
+}
+
+void* FormulaEnvironment::FormulaPrivate::operator new(std::size_t size)
+{
+    return NodeArena::allocate(size);
+}
+
+void FormulaEnvironment::FormulaPrivate::operator delete(void *pointer)
+{
+    NodeArena::deallocate(pointer);
+}
+
+uint64_t FormulaEnvironment::FormulaPrivate::nextSerial()
+{
+    static std::atomic<uint64_t> counter;
+
+    return ++counter;
+}
+
+// Shards are chosen by the highest bits of the hash, the lowest ones choose
+// buckets inside a shard.
+FormulaEnvironment::FormulaPrivate::Shard& FormulaEnvironment::FormulaPrivate::shard(size_t hash)
+{
+    // Never destroyed, because formulas can outlive static objects.
+    static Shard *result = new Shard[std::size_t(1) << shardBits];
+
+    return result[hash >> (8 * sizeof(size_t) - shardBits)];
+}
+
+// Must be called with the mutex of the shard locked.
+std::shared_ptr<FormulaEnvironment::FormulaPrivate> FormulaEnvironment::FormulaPrivate::lookup(Shard &shard, const FormulaPrivate &formula)
+{
+    auto range = shard.nodes.equal_range(formula.hashValue);
+
+    for (auto i = range.first; i != range.second; ++i) {
+        if (i->second.first->equals(formula)) {
+            std::shared_ptr<FormulaPrivate> result = i->second.second.lock();
+
+            if ((bool)result) {
+                return result;
+            }
+        }
+    }
+
+    return std::shared_ptr<FormulaPrivate>();
+}
+
+// As for terms, no deleter runs while the mutex of a shard is locked, and
+// the result is promoted while no arena is active.
+std::shared_ptr<FormulaEnvironment::FormulaPrivate> FormulaEnvironment::FormulaPrivate::intern(FormulaPrivate *formula)
+{
+    std::unique_ptr<FormulaPrivate> candidate(formula);
+    Shard &s = shard(formula->hashValue);
+    std::shared_ptr<FormulaPrivate> result;
+
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+
+        result = lookup(s, *formula);
+    }
+
+    if ((bool)result == false) {
+        std::shared_ptr<FormulaPrivate> fresh(candidate.release(), release, NodeAllocator<FormulaPrivate>());
+
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+
+            result = lookup(s, *fresh);
+
+            if ((bool)result == false) {
+                s.nodes.emplace(fresh->hashValue, std::make_pair(fresh.get(), std::weak_ptr<FormulaPrivate>(fresh)));
+                result = fresh;
+            }
+        }
+    }
+
+    if (NodeArena::active() == nullptr) {
+        return promote(result);
+    }
+
+    return result;
+}
+
+// As for terms.
+bool FormulaEnvironment::FormulaPrivate::settled(const std::shared_ptr<FormulaPrivate> &formula)
+{
+    if ((bool)formula == false) {
+        return true;
+    }
+
+    if (NodeArena::persistent(formula.get()) == false) {
+        return false;
+    }
+
+    for (auto i = formula->terms.cbegin(); i != formula->terms.cend(); ++i) {
+        if (i->isPersistent() == false) {
+            return false;
+        }
+    }
+
+    for (auto i = formula->formulas.cbegin(); i != formula->formulas.cend(); ++i) {
+        if ((bool)i->formulaPtr && NodeArena::persistent(i->formulaPtr.get()) == false) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// As for terms.
+std::shared_ptr<FormulaEnvironment::FormulaPrivate> FormulaEnvironment::FormulaPrivate::promote(const std::shared_ptr<FormulaPrivate> &formula)
+{
+    if (settled(formula)) {
+        return formula;
+    }
+
+    NodeArena::Heap heap;
+    std::vector<Term> terms;
+    std::vector<Formula> formulas;
+
+    terms.reserve(formula->terms.size());
+    formulas.reserve(formula->formulas.size());
+
+    for (auto i = formula->terms.cbegin(); i != formula->terms.cend(); ++i) {
+        terms.push_back(i->persistent());
+    }
+
+    for (auto i = formula->formulas.cbegin(); i != formula->formulas.cend(); ++i) {
+        formulas.push_back(i->persistent());
+    }
+
+    std::shared_ptr<FormulaPrivate> copy(new FormulaPrivate(*formula, std::move(terms), std::move(formulas)), release,
+                                         NodeAllocator<FormulaPrivate>());
+    std::shared_ptr<FormulaPrivate> other;
+    Shard &s = shard(formula->hashValue);
+
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto range = s.nodes.equal_range(formula->hashValue);
+
+        for (auto i = range.first; i != range.second; ++i) {
+            if (i->second.first->serial == formula->serial) {
+                other = i->second.second.lock();
+
+                if ((bool)other && other != formula && settled(other)) {
+                    return other;
+                }
+
+                i->second = std::make_pair(copy.get(), std::weak_ptr<FormulaPrivate>(copy));
+                formula->promoted = copy;
+
+                return copy;
+            }
+        }
+
+        s.nodes.emplace(copy->hashValue, std::make_pair(copy.get(), std::weak_ptr<FormulaPrivate>(copy)));
+    }
+
+    return copy;
+}
+
+// Also called for a candidate which was never put in the table.
+void FormulaEnvironment::FormulaPrivate::release(FormulaPrivate *formula)
+{
+    Shard &s = shard(formula->hashValue);
+
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto range = s.nodes.equal_range(formula->hashValue);
+
+        for (auto i = range.first; i != range.second; ++i) {
+            if (i->second.first == formula) {
+                s.nodes.erase(i);
+
+                break;
+            }
+        }
+    }
+
+    delete formula;
+}
+
+size_t FormulaEnvironment::FormulaPrivate::hashOf(const Symbol &symbol, const std::vector<Term> &terms,
+                                                  const std::vector<Formula> &formulas, const std::vector<Variable> &variables)
 {
+    size_t result = hashCombine(symbol.type, symbol.id);
+
+    result = hashCombine(result, terms.size());
+
+    for (size_t i = 0; i < terms.size(); ++i) {
+        result = hashCombine(result, terms[i].hash());
+    }
+
+    result = hashCombine(result, formulas.size());
+
+    for (size_t i = 0; i < formulas.size(); ++i) {
+        result = hashCombine(result, formulas[i].hash());
+    }
+
+    result = hashCombine(result, variables.size());
+
+    for (size_t i = 0; i < variables.size(); ++i) {
+        result = hashCombine(result, variables[i].id);
+    }
+
+    return result;
 }
 
-FormulaEnvironment::FormulaPrivate::FormulaPrivate(FormulaPrivate &&other) :
-    symbol(other.symbol),
-    terms(std::move(other.terms)),
-    formulas(std::move(other.formulas)),
-    freeVariables(std::move(other.freeVariables))
+size_t FormulaEnvironment::FormulaPrivate::hash() const
 {
+    return hashValue;
 }
 
-bool FormulaEnvironment::FormulaPrivate::operator ==(const FormulaPrivate &other) const
+bool FormulaEnvironment::FormulaPrivate::equals(const FormulaPrivate &other) const
 {
-    if (symbol != other.symbol || terms.size() != other.terms.size() || formulas.size() != other.formulas.size()) {
+    if (symbol != other.symbol || terms.size() != other.terms.size() || formulas.size() != other.formulas.size() ||
+            variables.size() != other.variables.size()) {
         return false;
     }
 
@@ -992,19 +2163,35 @@ bool FormulaEnvironment::FormulaPrivate::operator ==(const FormulaPrivate &other
         }
     }
 
+    for (std::size_t i = 0; i < variables.size(); ++i) {
+        if (variables[i] != other.variables[i]) {
+            return false;
+        }
+    }
+
     return true;
 }
 
+bool FormulaEnvironment::FormulaPrivate::operator ==(const FormulaPrivate &other) const
+{
+    return serial == other.serial;
+}
+
 bool FormulaEnvironment::FormulaPrivate::operator !=(const FormulaPrivate &other) const
 {
-    return operator ==(other) == false;
+    return serial != other.serial;
 }
 
+// Structural order, as for terms.
 int FormulaEnvironment::FormulaPrivate::compare(const FormulaPrivate &other) const
 {
+    if (serial == other.serial) {
+        return 0;
+    }
+
     int result = symbol.compare(other.symbol);
 
-    if (result) {
+    if (result != 0) {
         return result;
     }
 
@@ -1016,6 +2203,10 @@ int FormulaEnvironment::FormulaPrivate::compare(const FormulaPrivate &other) con
         return (formulas.size() < other.formulas.size()) ? -1 : 1;
     }
 
+    if (variables.size() != other.variables.size()) {
+        return (variables.size() < other.variables.size()) ? -1 : 1;
+    }
+
     for (std::size_t i = 0; i < terms.size(); ++i) {
         result = terms[i].compare(other.terms[i]);
 
@@ -1032,6 +2223,14 @@ int FormulaEnvironment::FormulaPrivate::compare(const FormulaPrivate &other) con
         }
     }
 
+    for (std::size_t i = 0; i < variables.size(); ++i) {
+        result = variables[i].compare(other.variables[i]);
+
+        if (result != 0) {
+            return result;
+        }
+    }
+
     return 0;
 }
 
@@ -1042,22 +2241,26 @@ bool FormulaEnvironment::FormulaPrivate::operator <(const FormulaPrivate &other)
 
 bool FormulaEnvironment::FormulaPrivate::isFreeVariable(const Variable &variable) const
 {
+    return getFreeVariables().count(variable) > 0;
+}
+
+VariableSet FormulaEnvironment::FormulaPrivate::computeFreeVariables() const
+{
+    VariableSet result;
+
     switch (symbol.type) {
     case NONE_SYMBOL:
-        return false;
-
+    case FALSE_SYMBOL:
+    case TRUE_SYMBOL:
         break;
 
     case EQUALITY:
+    case NONEQUALITY:
     case RELATION:
         for (size_t i = 0; i < terms.size(); ++i) {
-            if (terms[i].isFreeVariable(variable)) {
-                return true;
-            }
+            result = result.unite(terms[i].getFreeVariables());
         }
 
-        return false;
-
         break;
 
     case NEGATION:
@@ -1066,93 +2269,37 @@ bool FormulaEnvironment::FormulaPrivate::isFreeVariable(const Variable &variable
     case IMPLICATION:
     case EQUIVALENCE:
         for (size_t i = 0; i < formulas.size(); ++i) {
-            if (formulas[i].isFreeVariable(variable)) {
-                return true;
-            }
+            result = result.unite(formulas[i].getFreeVariables());
         }
 
-        return false;
+        break;
 
     case UNIVERSAL:
     case EXISTENTIAL:
-        for (size_t i = 0; i < variables.size(); ++i)
-        if (variables[i] == variable) {
-            return false;
-        }
-
         for (size_t i = 0; i < formulas.size(); ++i) {
-            if (formulas[i].isFreeVariable(variable)) {
-                return true;
-            }
+            result = result.unite(formulas[i].getFreeVariables());
         }
 
-        return false;
+        result = result.remove(variables);
+
+        break;
 
     default:
         throw(1);
 
         break;
     }
+
+    return result;
 }
 
-const std::set<Variable>& FormulaEnvironment::FormulaPrivate::getFreeVariables() const
+const VariableSet& FormulaEnvironment::FormulaPrivate::getFreeVariables() const
 {
-    if ((bool)freeVariables == false) {
-        std::shared_ptr<std::set<Variable>> freeVariables(new std::set<Variable>);
-
-        switch (symbol.type) {
-        case NONE_SYMBOL:
-        case FALSE_SYMBOL:
-        case TRUE_SYMBOL:
-            break;
-
-        case EQUALITY:
-        case RELATION:
-            for (size_t i = 0; i < terms.size(); ++i) {
-                const std::set<Variable> &variables = terms[i].getFreeVariables();
-
-                freeVariables->insert(variables.begin(), variables.end());
-            }
-
-            break;
-
-        case NEGATION:
-        case CONJUNCTION:
-        case DISJUNCTION:
-        case IMPLICATION:
-        case EQUIVALENCE:
-            for (size_t i = 0; i < formulas.size(); ++i) {
-                const std::set<Variable> &variables = formulas[i].getFreeVariables();
-
-                freeVariables->insert(variables.begin(), variables.end());
-            }
-
-            break;
-
-        case UNIVERSAL:
-        case EXISTENTIAL:
-            for (size_t i = 0; i < formulas.size(); ++i) {
-                const std::set<Variable> &variables = formulas[i].getFreeVariables();
-
-                freeVariables->insert(variables.begin(), variables.end());
-            }
-
-            for (size_t i = 0; i < variables.size(); ++i) {
-                freeVariables->erase(variables[i]);
-            }
-
-            break;
-
-        default:
-            throw(1);
-
-            break;
-        }
+    std::call_once(freeVariablesFlag, [this]() {
+        freeVariables = computeFreeVariables();
+    });
 
-        this->freeVariables = freeVariables;
-    }
-
-    return *freeVariables;
+    return freeVariables;
 }
 
 const FormulaEnvironment::FormulaPrivate& FormulaEnvironment::FormulaPrivate::dummy()
@@ -1337,8 +2484,14 @@ FormulaEnvironment::ExistentialFormulaPrivate::ExistentialFormulaPrivate(const F
 }
 
 FormulaEnvironment::Formula::Formula(FormulaPrivate *formulaPtr) :
+    formulaPtr(FormulaPrivate::intern(formulaPtr)),
+    formula(*this->formulaPtr)
+{
+}
+
+FormulaEnvironment::Formula::Formula(const std::shared_ptr<FormulaPrivate> &formulaPtr) :
     formulaPtr(formulaPtr),
-    formula(*formulaPtr)
+    formula(*this->formulaPtr)
 {
 }
 
@@ -1355,12 +2508,12 @@ FormulaEnvironment::Formula::Formula(const Formula &other) :
 
 bool FormulaEnvironment::Formula::operator ==(const Formula &other) const
 {
-    return formula == other.formula;
+    return formula.serial == other.formula.serial;
 }
 
 bool FormulaEnvironment::Formula::operator !=(const Formula &other) const
 {
-    return operator ==(other) == false;
+    return formula.serial != other.formula.serial;
 }
 
 int FormulaEnvironment::Formula::compare(const Formula &other) const
@@ -1370,7 +2523,7 @@ int FormulaEnvironment::Formula::compare(const Formula &other) const
 
 bool FormulaEnvironment::Formula::operator <(const Formula &other) const
 {
-    return compare(other) < 0;
+    return formula.compare(other.formula) < 0;
 }
 
 const Symbol& FormulaEnvironment::Formula::symbol() const
@@ -1388,6 +2541,16 @@ uint64_t FormulaEnvironment::Formula::id() const
     return formula.symbol.id;
 }
 
+uint64_t FormulaEnvironment::Formula::serial() const
+{
+    return formula.serial;
+}
+
+size_t FormulaEnvironment::Formula::hash() const
+{
+    return formula.hashValue;
+}
+
 const std::vector<Term>& FormulaEnvironment::Formula::terms() const
 {
     return formula.terms;
@@ -1408,20 +2571,45 @@ bool FormulaEnvironment::Formula::isFreeVariable(const Variable &variable) const
     return formula.isFreeVariable(variable);
 }
 
-const std::set<Variable>& FormulaEnvironment::Formula::getFreeVariables() const
+const VariableSet& FormulaEnvironment::Formula::getFreeVariables() const
 {
     return formula.getFreeVariables();
 }
 
+bool FormulaEnvironment::Formula::isGround() const
+{
+    return formula.getFreeVariables().empty();
+}
+
 bool FormulaEnvironment::Formula::isEmpty() const
 {
     return formula.symbol.type == NONE_SYMBOL;
 }
 
+bool FormulaEnvironment::Formula::isPersistent() const
+{
+    return FormulaPrivate::settled(formulaPtr);
+}
+
+// As for terms.
+FormulaEnvironment::Formula FormulaEnvironment::Formula::persistent() const
+{
+    if ((bool)formulaPtr == false) {
+        return *this;
+    }
+
+    return Formula(FormulaPrivate::promote(formulaPtr));
+}
+
 FormulaEnvironment::Formula FormulaEnvironment::Formula::operator [](const TermEnvironment::Substitution &substitution) const
 {
     std::map<Variable, Term> data;
 
+    // Subformulas without substituted free variables are shared, not rebuilt.
+    if (!substitution.affects(getFreeVariables())) {
+        return *this;
+    }
+
     switch (formula.symbol.type) {
     case NONE_SYMBOL:
         return *this;
@@ -1533,36 +2721,29 @@ FormulaEnvironment::Formula FormulaEnvironment::Formula::operator [](const TermE
 
     case UNIVERSAL: case EXISTENTIAL:
     {
-        const std::set<Variable> &fv = getFreeVariables();
+        // The body gets the substitution restricted to the free variables
+        // of the quantified formula; bound variables which would capture
+        // a variable of the substituted terms are renamed.
+        const VariableSet &fv = getFreeVariables();
         const std::vector<Variable> &v = variables();
         std::vector<Variable> qs;
-        std::set<Variable> tfv;
-        std::set<Variable> bounded;
-
-        for (size_t i = 0; i < v.size(); ++i) {
-            bounded.insert(v[i]);
-        }
-
-        for (std::map<Variable, Term>::const_iterator i = substitution.data.cbegin(); i != substitution.data.cend(); ++i) {
-            Variable x = i->first;
-
-            if (fv.count(x)) {
-                const std::set<Variable> &tv = (i->second).getFreeVariables();
+        VariableSet tfv;
 
-                tfv.insert(tv.cbegin(), tv.cend());
+        for (std::vector<std::pair<Variable, Term>>::const_iterator i = substitution.data.cbegin(); i != substitution.data.cend(); ++i) {
+            if (fv.count(i->first)) {
+                data.insert(*i);
+                tfv = tfv.unite((i->second).getFreeVariables());
             }
         }
 
-        for (std::set<Variable>::const_iterator i = bounded.cbegin(); i != bounded.cend(); ++i) {
-            if (tfv.count(*i)) {
+        for (size_t i = 0; i < v.size(); ++i) {
+            if (tfv.count(v[i])) {
                 Variable y;
-                Term t(y);
 
-                data.insert(std::pair<Variable, Term>(*i, t));
+                data.insert(std::pair<Variable, Term>(v[i], Term(y)));
                 qs.push_back(y);
             } else {
-                data.insert(std::pair<Variable, Term>(*i, substitution(*i)));
-                qs.push_back(*i);
+                qs.push_back(v[i]);
             }
         }
 
@@ -1591,7 +2772,74 @@ const FormulaEnvironment::Formula& FormulaEnvironment::Formula::dummy()
     return result;
 }
 
+// The result is cached in the internal object. One call simplifies a
+// subformula (including negations built on the way) only once, results
+// for subformulas are then cached as well.
 FormulaEnvironment::Formula FormulaEnvironment::Formula::simplify() const
+{
+    std::unordered_map<Formula, Formula> memo;
+
+    std::call_once(formula.simplifiedFlag, [this, &memo]() {
+        setSimplified(simplifyNode(memo));
+    });
+
+    for (auto i = memo.cbegin(); i!=memo.cend(); ++i) {
+        const Formula &f = i->first;
+        const Formula &result = i->second;
+
+        std::call_once(f.formula.simplifiedFlag, [&f, &result]() {
+            f.setSimplified(result);
+        });
+    }
+
+    if (formula.simplifiedSelf) {
+        return *this;
+    }
+
+    return Formula(formula.simplified);
+}
+
+FormulaEnvironment::Formula FormulaEnvironment::Formula::simplify(std::unordered_map<Formula, Formula> &memo) const
+{
+    if (formula.simplifiedReady.load(std::memory_order_acquire)) {
+        if (formula.simplifiedSelf) {
+            return *this;
+        }
+
+        return Formula(formula.simplified);
+    }
+
+    auto i = memo.find(*this);
+
+    if (i!=memo.cend()) {
+        return i->second;
+    }
+
+    Formula result = simplifyNode(memo);
+
+    memo.insert(std::pair<Formula, Formula>(*this, result));
+
+    return result;
+}
+
+// Result for a persistent formula is made persistent, so that it does not
+// keep a chunk of an arena alive.
+void FormulaEnvironment::Formula::setSimplified(const Formula &result) const
+{
+    if (result == *this) {
+        formula.simplifiedSelf = true;
+    } else if ((bool)formulaPtr && isPersistent()) {
+        NodeArena::Heap heap;
+
+        formula.simplified = FormulaPrivate::promote(result.formulaPtr);
+    } else {
+        formula.simplified = result.formulaPtr;
+    }
+
+    formula.simplifiedReady.store(true, std::memory_order_release);
+}
+
+FormulaEnvironment::Formula FormulaEnvironment::Formula::simplifyNode(std::unordered_map<Formula, Formula> &memo) const
 {
     switch (type()) {
     case EQUALITY:
@@ -1623,7 +2871,7 @@ FormulaEnvironment::Formula FormulaEnvironment::Formula::simplify() const
                     result.push_back(*i);
                 }
 
-                return EqualityFormula(result).simplify();
+                return EqualityFormula(result).simplify(memo);
             }
 
             return FalseFormula();
@@ -1634,7 +2882,7 @@ FormulaEnvironment::Formula FormulaEnvironment::Formula::simplify() const
 
     case NEGATION:
     {
-        Formula arg = formulas()[0].simplify();
+        Formula arg = formulas()[0].simplify(memo);
 
         switch (arg.type()) {
         case FALSE_SYMBOL:
@@ -1673,38 +2921,38 @@ FormulaEnvironment::Formula FormulaEnvironment::Formula::simplify() const
             std::vector<Formula> args;
 
             for (auto i = formulas.cbegin(); i!=formulas.cend(); ++i) {
-                args.push_back(NegationFormula(*i).simplify());
+                args.push_back(NegationFormula(*i).simplify(memo));
             }
 
             if (arg.type()==CONJUNCTION) {
-                return FormulaEnvironment::DisjunctionFormula(args);
+                return FormulaEnvironment::DisjunctionFormula(args).simplify(memo);
             }
 
-            return FormulaEnvironment::ConjunctionFormula(args);
+            return FormulaEnvironment::ConjunctionFormula(args).simplify(memo);
         }
 
             break;
 
         case IMPLICATION:
             if (arg.formulas().size()==2) {
-                Formula f1 = arg.formulas()[0].simplify();
-                Formula f2 = arg.formulas()[1].simplify();
+                Formula f1 = arg.formulas()[0].simplify(memo);
+                Formula f2 = arg.formulas()[1].simplify(memo);
 
-                return ConjunctionFormula(f1, NegationFormula(f2).simplify());
+                return ConjunctionFormula(f1, NegationFormula(f2).simplify(memo)).simplify(memo);
             }
 
             break;
 
             if (arg.formulas().size()==2) {
-                Formula f1 = arg.formulas()[0].simplify();
-                Formula f2 = arg.formulas()[1].simplify();
+                Formula f1 = arg.formulas()[0].simplify(memo);
+                Formula f2 = arg.formulas()[1].simplify(memo);
 
                 if (f1.type()==NEGATION) {
-                    return ConjunctionFormula(NegationFormula(f1).simplify(), f2);
+                    return ConjunctionFormula(NegationFormula(f1).simplify(memo), f2);
                 }
 
                 if (f2.type()==NEGATION) {
-                    return ConjunctionFormula(f1, NegationFormula(f2).simplify());
+                    return ConjunctionFormula(f1, NegationFormula(f2).simplify(memo));
                 }
             }
 
@@ -1713,7 +2961,7 @@ FormulaEnvironment::Formula FormulaEnvironment::Formula::simplify() const
         case UNIVERSAL:
         case EXISTENTIAL:
         {
-            Formula f = FormulaEnvironment::NegationFormula(arg.formulas()[0]).simplify();
+            Formula f = FormulaEnvironment::NegationFormula(arg.formulas()[0]).simplify(memo);
 
             if (arg.type()==UNIVERSAL) {
                 return FormulaEnvironment::ExistentialFormula(f, arg.variables());
@@ -1738,7 +2986,7 @@ FormulaEnvironment::Formula FormulaEnvironment::Formula::simplify() const
         std::vector<Formula> result;
 
         for (auto i = formulas().cbegin(); i!=formulas().cend(); ++i) {
-            Formula f = i->simplify();
+            Formula f = i->simplify(memo);
 
             if (f.type()==type()) {
                 for (auto j = f.formulas().cbegin(); j!=f.formulas().cend(); ++j) {
@@ -1792,7 +3040,7 @@ FormulaEnvironment::Formula FormulaEnvironment::Formula::simplify() const
         size_t truePosition;
 
         for (size_t i = 0; i<formulas().size(); ++i) {
-            Formula f = formulas()[i].simplify();
+            Formula f = formulas()[i].simplify(memo);
 
             fs.push_back(f);
 
@@ -1826,7 +3074,7 @@ FormulaEnvironment::Formula FormulaEnvironment::Formula::simplify() const
         if (hasFalse) {
             for (size_t i = 0; i<falsePosition; ++i) {
                 if (fs[i].type()!=FALSE_SYMBOL) {
-                    result.push_back(NegationFormula(fs[i]).simplify());
+                    result.push_back(NegationFormula(fs[i]).simplify(memo));
                 }
             }
         }
@@ -1891,11 +3139,19 @@ FormulaEnvironment::Formula FormulaEnvironment::Formula::simplify() const
             }
         }
 
+        if (result.empty()) {
+            return TrueFormula();
+        }
+
         if (result.size()==formulas().size()) {
             return ImplicationFormula(result);
         }
 
-        return ConjunctionFormula(result);
+        if (result.size()==1) {
+            return result[0];
+        }
+
+        return ConjunctionFormula(result).simplify(memo);
     }
 
         break;
@@ -1908,7 +3164,7 @@ FormulaEnvironment::Formula FormulaEnvironment::Formula::simplify() const
         bool hasTrue = false;
 
         for (size_t i = 0; i<formulas().size(); ++i) {
-            Formula f = formulas()[i].simplify();
+            Formula f = formulas()[i].simplify(memo);
 
             if (f.type()==NONE_SYMBOL) {
                 return EmptyFormula();
@@ -1937,7 +3193,7 @@ FormulaEnvironment::Formula FormulaEnvironment::Formula::simplify() const
             result.push_back(*i);
         }
 
-        if (result.size()==1) {
+        if (result.size()==1 && hasFalse==false && hasTrue==false) {
             return TrueFormula();
         }
 
@@ -1948,11 +3204,11 @@ FormulaEnvironment::Formula FormulaEnvironment::Formula::simplify() const
                 negatedFormulas.push_back(NegationFormula(result[i]));
             }
 
-            return ConjunctionFormula(negatedFormulas).simplify();
+            return ConjunctionFormula(negatedFormulas).simplify(memo);
         }
 
         if (hasTrue) {
-            return ConjunctionFormula(result).simplify();
+            return ConjunctionFormula(result).simplify(memo);
         }
 
         return EquivalenceFormula(result);
@@ -1963,17 +3219,14 @@ FormulaEnvironment::Formula FormulaEnvironment::Formula::simplify() const
     case UNIVERSAL:
     case EXISTENTIAL:
     {
-        Formula f = formulas()[0].simplify();
-        std::set<Variable> freeVars = f.getFreeVariables();
+        Formula f = formulas()[0].simplify(memo);
+        const VariableSet &freeVars = f.getFreeVariables();
         std::set<Variable> vars;
         std::vector<Variable> result;
 
         for (auto i = variables().cbegin(); i!=variables().cend(); ++i) {
-            auto j = freeVars.find(*i);
-
-            if (j!=freeVars.cend()) {
+            if (freeVars.count(*i)) {
                 vars.insert(*i);
-                freeVars.erase(j);
             }
         }
 
@@ -2011,7 +3264,68 @@ FormulaEnvironment::Formula FormulaEnvironment::Formula::simplify() const
     return *this;
 }
 
+// Classification is computed once for every internal object.
+const FormulaEnvironment::FormulaPrivate& FormulaEnvironment::Formula::classified() const
+{
+    std::call_once(formula.uniformTypeFlag, [this]() {
+        // Components of a persistent formula are made persistent.
+        NodeArena::Heap heap((bool)formulaPtr && isPersistent());
+
+        formula.uniformTypeValue = computeUniformType(formula.uniformArgs, formula.uniformVariables);
+
+        if (formula.uniformArgs.size()==1 && formula.uniformArgs[0]==*this) {
+            formula.uniformArgs.clear();
+            formula.uniformSelf = true;
+        }
+    });
+
+    return formula;
+}
+
 UniformType FormulaEnvironment::Formula::uniformType(std::vector<Formula> &args, std::set<Variable> &vars) const
+{
+    const FormulaPrivate &f = classified();
+
+    args = std::vector<Formula>(f.uniformArgs);
+    vars = f.uniformVariables;
+
+    if (f.uniformSelf) {
+        args.push_back(*this);
+    }
+
+    return f.uniformTypeValue;
+}
+
+UniformType FormulaEnvironment::Formula::uniformType() const
+{
+    return classified().uniformTypeValue;
+}
+
+// Components of the uniform type. For a literal which is the formula
+// itself this is empty, see literal().
+const std::vector<FormulaEnvironment::Formula>& FormulaEnvironment::Formula::uniformArgs() const
+{
+    return classified().uniformArgs;
+}
+
+const std::set<Variable>& FormulaEnvironment::Formula::uniformVariables() const
+{
+    return classified().uniformVariables;
+}
+
+// Normal form of a formula of uniform type LITERAL.
+FormulaEnvironment::Formula FormulaEnvironment::Formula::literal() const
+{
+    const FormulaPrivate &f = classified();
+
+    if (f.uniformSelf) {
+        return *this;
+    }
+
+    return f.uniformArgs[0];
+}
+
+UniformType FormulaEnvironment::Formula::computeUniformType(std::vector<Formula> &args, std::set<Variable> &vars) const
 {
     args.clear();
     vars.clear();
@@ -2562,4 +3876,105 @@ FormulaEnvironment::ExistentialFormula::ExistentialFormula(const Formula &formul
 {
 }
 
+// Bound variables of pattern are bound to the corresponding bound
+// variables of target for the body only. A free variable of pattern may
+// not be bound to a term containing a bound variable of target.
+bool FormulaEnvironment::match(const Formula &pattern, const Formula &target, std::vector<std::pair<Variable, Term>> &bindings)
+{
+    size_t size = bindings.size();
+    bool result = true;
+
+    // A closed pattern may still match a variant of itself.
+    if (pattern.isGround() && pattern == target) {
+        return true;
+    }
+
+    if (pattern.type() != target.type() || pattern.terms().size() != target.terms().size() ||
+        pattern.formulas().size() != target.formulas().size() || pattern.variables().size() != target.variables().size()) {
+        return false;
+    }
+
+    switch (pattern.type()) {
+    case RELATION: case EQUALITY: case NONEQUALITY:
+        if (pattern.type() == RELATION && pattern.symbol() != target.symbol()) {
+            return false;
+        }
+
+        for (size_t i = 0; result && i < pattern.terms().size(); ++i) {
+            result = TermEnvironment::match(pattern.terms()[i], target.terms()[i], bindings);
+        }
+
+        break;
+
+    case NEGATION: case CONJUNCTION: case DISJUNCTION: case IMPLICATION: case EQUIVALENCE:
+        for (size_t i = 0; result && i < pattern.formulas().size(); ++i) {
+            result = match(pattern.formulas()[i], target.formulas()[i], bindings);
+        }
+
+        break;
+
+    case UNIVERSAL: case EXISTENTIAL:
+    {
+        const std::vector<Variable> &v = pattern.variables();
+        const std::vector<Variable> &w = target.variables();
+        VariableSet bound;
+
+        for (size_t i = 0; i < v.size(); ++i) {
+            bindings.push_back(std::pair<Variable, Term>(v[i], Term(w[i])));
+            bound = bound.unite(VariableSet(w[i]));
+        }
+
+        result = match(pattern.formulas()[0], target.formulas()[0], bindings);
+
+        const VariableSet &fv = pattern.getFreeVariables();
+
+        for (VariableSet::const_iterator i = fv.cbegin(); result && i != fv.cend(); ++i) {
+            const Term *t = TermEnvironment::binding(*i, bindings);
+
+            result = t == nullptr || !t->getFreeVariables().intersects(bound);
+        }
+
+        std::vector<std::pair<Variable, Term>> inner;
+
+        for (size_t i = size + v.size(); result && i < bindings.size(); ++i) {
+            inner.push_back(bindings[i]);
+        }
+
+        while (bindings.size() > size) {
+            bindings.pop_back();
+        }
+
+        for (size_t i = 0; result && i < inner.size(); ++i) {
+            bindings.push_back(inner[i]);
+        }
+
+        return result;
+    }
+
+    default:
+        return pattern == target;
+    }
+
+    if (!result) {
+        while (bindings.size() > size) {
+            bindings.pop_back();
+        }
+    }
+
+    return result;
+}
+
+Substitution FormulaEnvironment::matcher(const Formula &pattern, const Formula &target, bool &ok)
+{
+    std::vector<std::pair<Variable, Term>> bindings;
+
+    ok = match(pattern, target, bindings);
+
+    if (!ok) {
+        return Substitution();
+    }
+
+    return Substitution(std::map<Variable, Term>(bindings.cbegin(), bindings.cend()));
+}
+
 #endif // LANGUAGE_IMP_H
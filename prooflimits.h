@@ -0,0 +1,156 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+/*!
+    \file "prooflimits.h"
+
+    \author Nedeljko Stefanovic
+
+    \brief Limits and cancellation of a proof search.
+
+    ProofLimits bounds elapsed time, tableau nodes, unifications and bytes
+    of internal objects allocated by a search, zero means no bound. It also
+    bounds rounds of iterative deepening on instances of gamma formulas per
+    branch, one by default and for a search without a control, zero for
+    rounds until another limit stops. A ProofControl object counts them for
+    one search and may be cancelled from any thread. While a
+    ProofControl::Scope exists, the search running in the same thread
+    reports to it's control through the static functions node, unification
+    and check, which throw ProofStoppedException (see "error.h") when a
+    limit is reached or the search is cancelled. Without an active control
+    these functions do nothing. The search also reports
+    lookups in it's table of met systems (see "transposition.h") through
+    transposition, the control counts them and the hits among them.
+
+    Bytes are taken from the NodeArena active in the thread (see "arena.h")
+    and counted from the first check of the search in that thread, which
+    covers terms, formulas and goal sets (see "formulaset.h"). Objects the
+    search keeps on the heap, such as systems, branches waiting in a pool
+    and entries of it's table of met systems, are reported through
+    allocated. Bytes are counted when they are allocated and never given
+    back, so the limit bounds all memory a search asks for.
+
+    A search with unbounded rounds of deepening and no other limit might
+    never stop, so such limits are rejected by ProofControl.
+*/
+
+#ifndef PROOFLIMITS_H
+#define PROOFLIMITS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "config.h"
+
+enum ProofResult
+{
+    PROVED,
+    REFUTED,
+    UNKNOWN
+};
+
+enum StopReason
+{
+    NOT_STOPPED,
+    TIME_LIMIT_REACHED,
+    NODE_LIMIT_REACHED,
+    UNIFICATION_LIMIT_REACHED,
+    MEMORY_LIMIT_REACHED,
+    INSTANCE_LIMIT_REACHED,
+    CANCELLED
+};
+
+struct ProofLimits
+{
+    std::chrono::steady_clock::duration time;
+    std::size_t nodes;
+    std::size_t unifications;
+    std::size_t bytes;
+    std::size_t instances;
+
+    DECLARE ProofLimits();
+};
+
+struct ProofOutcome
+{
+    ProofResult result;
+    StopReason reason;
+
+    DECLARE ProofOutcome(ProofResult result, StopReason reason = NOT_STOPPED);
+};
+
+class ProofControl
+{
+    const ProofLimits limits;
+    const std::chrono::steady_clock::time_point start;
+    const uint64_t serial;
+    std::atomic<std::size_t> nodes;
+    std::atomic<std::size_t> unifications;
+    std::atomic<std::size_t> bytes;
+    std::atomic<std::size_t> lookups;
+    std::atomic<std::size_t> hits;
+    std::atomic<bool> cancelled;
+    std::atomic<int> stopReason;
+
+    ProofControl(const ProofControl&) = delete;
+    ProofControl& operator =(const ProofControl&) = delete;
+    DECLARE static ProofControl*& current();
+    DECLARE static uint64_t nextSerial();
+    DECLARE void stop(StopReason reason);
+    DECLARE void checkAll();
+
+public:
+    class Scope
+    {
+        ProofControl *previous;
+
+        Scope(const Scope&) = delete;
+        Scope& operator =(const Scope&) = delete;
+
+    public:
+        DECLARE Scope(ProofControl *control);
+        DECLARE ~Scope();
+    };
+
+    DECLARE ProofControl(const ProofLimits &limits = ProofLimits());
+    DECLARE void cancel();
+    DECLARE StopReason reason() const;
+    DECLARE std::size_t nodeCount() const;
+    DECLARE std::size_t unificationCount() const;
+    DECLARE std::size_t byteCount() const;
+    DECLARE std::size_t transpositionLookups() const;
+    DECLARE std::size_t transpositionHits() const;
+    DECLARE std::chrono::steady_clock::duration elapsed() const;
+    DECLARE std::size_t instanceLimit() const;
+    DECLARE static ProofControl* active();
+    DECLARE static void node();
+    DECLARE static void unification();
+    DECLARE static void allocated(std::size_t bytes);
+    DECLARE static void check();
+    DECLARE static void transposition(bool hit);
+};
+
+#ifdef INLINE
+
+#include "prooflimits_imp.h"
+
+#endif
+
+#endif // PROOFLIMITS_H
@@ -0,0 +1,265 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#ifndef PROOFLIMITS_IMP_H
+#define PROOFLIMITS_IMP_H
+
+#include "arena.h"
+#include "error.h"
+#include "prooflimits.h"
+
+ProofLimits::ProofLimits() :
+    time(std::chrono::steady_clock::duration::zero()),
+    nodes(0),
+    unifications(0),
+    bytes(0),
+    instances(1)
+{
+}
+
+ProofOutcome::ProofOutcome(ProofResult result, StopReason reason) :
+    result(result),
+    reason(reason)
+{
+}
+
+ProofControl*& ProofControl::current()
+{
+    thread_local static ProofControl *result = nullptr;
+
+    return result;
+}
+
+// Serial numbers tell controls apart in per thread state, addresses could
+// be reused.
+uint64_t ProofControl::nextSerial()
+{
+    static std::atomic<uint64_t> result(0);
+
+    return ++result;
+}
+
+// The first reason is kept, every thread of the search stops with it.
+void ProofControl::stop(StopReason reason)
+{
+    int expected = NOT_STOPPED;
+
+    stopReason.compare_exchange_strong(expected, reason);
+
+    throw(ProofStoppedException());
+}
+
+// Clock is read on every 16th check in a thread.
+void ProofControl::checkAll()
+{
+    struct ThreadState
+    {
+        uint64_t control;
+        const NodeArena *arena;
+        std::size_t bytes;
+        unsigned checks;
+    };
+
+    thread_local static ThreadState state = {0, nullptr, 0, 0};
+
+    if (stopReason!=NOT_STOPPED) {
+        throw(ProofStoppedException());
+    }
+
+    if (cancelled) {
+        stop(CANCELLED);
+    }
+
+    if (state.control!=serial) {
+        state.control = serial;
+        state.arena = nullptr;
+        state.checks = 0;
+    }
+
+    const NodeArena *arena = NodeArena::active();
+
+    if (arena!=nullptr) {
+        if (arena!=state.arena) {
+            state.arena = arena;
+            state.bytes = arena->allocatedBytes();
+        }
+
+        std::size_t now = arena->allocatedBytes();
+
+        bytes += now-state.bytes;
+        state.bytes = now;
+    }
+
+    if (limits.bytes>0 && bytes>limits.bytes) {
+        stop(MEMORY_LIMIT_REACHED);
+    }
+
+    if (limits.time>std::chrono::steady_clock::duration::zero() && state.checks++%16==0 && elapsed()>limits.time) {
+        stop(TIME_LIMIT_REACHED);
+    }
+}
+
+ProofControl::Scope::Scope(ProofControl *control) :
+    previous(current())
+{
+    current() = control;
+}
+
+ProofControl::Scope::~Scope()
+{
+    current() = previous;
+}
+
+ProofControl::ProofControl(const ProofLimits &limits) :
+    limits(limits),
+    start(std::chrono::steady_clock::now()),
+    serial(nextSerial()),
+    nodes(0),
+    unifications(0),
+    bytes(0),
+    lookups(0),
+    hits(0),
+    cancelled(false),
+    stopReason(NOT_STOPPED)
+{
+    if (limits.instances==0 && limits.time<=std::chrono::steady_clock::duration::zero() &&
+        limits.nodes==0 && limits.unifications==0 && limits.bytes==0) {
+        throw(0);
+    }
+}
+
+// May be called from any thread, the search stops at it's next check.
+void ProofControl::cancel()
+{
+    cancelled = true;
+}
+
+StopReason ProofControl::reason() const
+{
+    return StopReason(stopReason.load());
+}
+
+std::size_t ProofControl::nodeCount() const
+{
+    return nodes;
+}
+
+std::size_t ProofControl::unificationCount() const
+{
+    return unifications;
+}
+
+std::size_t ProofControl::byteCount() const
+{
+    return bytes;
+}
+
+std::size_t ProofControl::transpositionLookups() const
+{
+    return lookups;
+}
+
+std::size_t ProofControl::transpositionHits() const
+{
+    return hits;
+}
+
+std::chrono::steady_clock::duration ProofControl::elapsed() const
+{
+    return std::chrono::steady_clock::now()-start;
+}
+
+std::size_t ProofControl::instanceLimit() const
+{
+    return limits.instances;
+}
+
+ProofControl* ProofControl::active()
+{
+    return current();
+}
+
+void ProofControl::node()
+{
+    ProofControl *control = current();
+
+    if (control==nullptr) {
+        return;
+    }
+
+    if (++control->nodes>control->limits.nodes && control->limits.nodes>0) {
+        control->stop(NODE_LIMIT_REACHED);
+    }
+
+    control->checkAll();
+}
+
+void ProofControl::unification()
+{
+    ProofControl *control = current();
+
+    if (control==nullptr) {
+        return;
+    }
+
+    if (++control->unifications>control->limits.unifications && control->limits.unifications>0) {
+        control->stop(UNIFICATION_LIMIT_REACHED);
+    }
+
+    control->checkAll();
+}
+
+void ProofControl::allocated(std::size_t bytes)
+{
+    ProofControl *control = current();
+
+    if (control==nullptr) {
+        return;
+    }
+
+    control->bytes += bytes;
+    control->checkAll();
+}
+
+void ProofControl::check()
+{
+    ProofControl *control = current();
+
+    if (control!=nullptr) {
+        control->checkAll();
+    }
+}
+
+void ProofControl::transposition(bool hit)
+{
+    ProofControl *control = current();
+
+    if (control==nullptr) {
+        return;
+    }
+
+    ++control->lookups;
+
+    if (hit) {
+        ++control->hits;
+    }
+}
+
+#endif // PROOFLIMITS_IMP_H
@@ -0,0 +1,85 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+/*!
+    \file "subsumption.h"
+
+    \author Nedeljko Stefanovic
+
+    \brief Index of goals which do not include each other.
+
+    SubsumptionIndex keeps a system in which no goal includes another one.
+    A goal which includes a kept goal is rejected when it is added, and kept
+    goals which include an added goal are removed. Every kept goal is watched
+    by its literal with the fewest occurrences, so a goal is compared only
+    with kept goals watched by one of its literals. Goals which include an
+    added goal are searched among occurrences of its rarest literal.
+    Inclusion itself is checked on GoalBits (see "goalbits.h").
+
+    Goals are not copied, the index points to them. An added goal has to
+    stay at it's address while the index is used, as an element of a
+    System does until it is erased. Removed goals are reported to the
+    caller, so they can be erased from the System as the index grows.
+*/
+
+#ifndef SUBSUMPTION_H
+#define SUBSUMPTION_H
+
+#include <unordered_map>
+#include <vector>
+#include "goalbits.h"
+#include "theory.h"
+
+class SubsumptionIndex
+{
+    struct Entry
+    {
+        const Goal *goal;
+        GoalBits bits;
+        bool kept;
+
+        DECLARE Entry(const Goal *goal, GoalBits &&bits);
+    };
+
+    LiteralIds ids;
+    std::vector<Entry> entries;
+    std::unordered_map<std::size_t, std::vector<std::size_t>> occurrences;
+    std::unordered_map<std::size_t, std::vector<std::size_t>> watches;
+    std::size_t count;
+    bool emptyKept;
+
+    DECLARE const std::vector<std::size_t>* find(const std::unordered_map<std::size_t, std::vector<std::size_t>> &lists,
+                                                std::size_t id) const;
+
+public:
+    DECLARE SubsumptionIndex();
+    DECLARE bool add(const Goal &goal);
+    DECLARE bool add(const Goal &goal, std::vector<const Goal*> &removed);
+    DECLARE std::size_t size() const;
+    DECLARE bool empty() const;
+};
+
+#ifdef INLINE
+
+#include "subsumption_imp.h"
+
+#endif
+
+#endif // SUBSUMPTION_H
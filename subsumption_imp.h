@@ -0,0 +1,155 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#ifndef SUBSUMPTION_IMP_H
+#define SUBSUMPTION_IMP_H
+
+#include "subsumption.h"
+
+SubsumptionIndex::Entry::Entry(const Goal *goal, GoalBits &&bits) :
+    goal(goal),
+    bits(std::move(bits)),
+    kept(true)
+{
+}
+
+SubsumptionIndex::SubsumptionIndex() :
+    count(0),
+    emptyKept(false)
+{
+}
+
+const std::vector<std::size_t>* SubsumptionIndex::find(const std::unordered_map<std::size_t, std::vector<std::size_t>> &lists,
+                                                       std::size_t id) const
+{
+    auto i = lists.find(id);
+
+    return i==lists.cend() ? nullptr : &i->second;
+}
+
+bool SubsumptionIndex::add(const Goal &goal)
+{
+    std::vector<const Goal*> removed;
+
+    return add(goal, removed);
+}
+
+// Returns false and leaves the index unchanged when goal includes some kept
+// goal, equal goal included. Otherwise goal is kept, and kept goals which
+// include it are removed and appended to removed. The empty goal is
+// included in every goal, so it is not watched by a literal but held by
+// emptyKept.
+bool SubsumptionIndex::add(const Goal &goal, std::vector<const Goal*> &removed)
+{
+    if (emptyKept) {
+        return false;
+    }
+
+    if (goal.empty()) {
+        for (auto i = entries.begin(); i!=entries.end(); ++i) {
+            if (i->kept) {
+                i->kept = false;
+                removed.push_back(i->goal);
+            }
+        }
+
+        entries.push_back(Entry(&goal, GoalBits(ids, goal)));
+        count = 1;
+        emptyKept = true;
+
+        return true;
+    }
+
+    std::vector<std::size_t> literals;
+
+    for (auto i = goal.cbegin(); i!=goal.cend(); ++i) {
+        literals.push_back(ids.add(*i));
+    }
+
+    GoalBits bits(ids, goal);
+
+    for (auto i = literals.cbegin(); i!=literals.cend(); ++i) {
+        const std::vector<std::size_t> *watching = find(watches, *i);
+
+        if (watching==nullptr) {
+            continue;
+        }
+
+        for (auto j = watching->cbegin(); j!=watching->cend(); ++j) {
+            const Entry &entry = entries[*j];
+
+            if (entry.kept && bits.includes(entry.bits)) {
+                return false;
+            }
+        }
+    }
+
+    std::size_t rarest = 0;
+    std::size_t rarestCount = 0;
+
+    for (auto i = literals.cbegin(); i!=literals.cend(); ++i) {
+        const std::vector<std::size_t> *occurring = find(occurrences, *i);
+        std::size_t occurringCount = occurring==nullptr ? 0 : occurring->size();
+
+        if (i==literals.cbegin() || occurringCount<rarestCount) {
+            rarest = *i;
+            rarestCount = occurringCount;
+        }
+    }
+
+    if (rarestCount>0) {
+        const std::vector<std::size_t> &occurring = occurrences[rarest];
+
+        for (auto i = occurring.cbegin(); i!=occurring.cend(); ++i) {
+            Entry &entry = entries[*i];
+
+            if (entry.kept && entry.bits.includes(bits)) {
+                entry.kept = false;
+                removed.push_back(entry.goal);
+                --count;
+            }
+        }
+    }
+
+    std::size_t index = entries.size();
+
+    entries.push_back(Entry(&goal, std::move(bits)));
+    ++count;
+
+    for (auto i = literals.cbegin(); i!=literals.cend(); ++i) {
+        occurrences[*i].push_back(index);
+    }
+
+    watches[rarest].push_back(index);
+
+    return true;
+}
+
+std::size_t SubsumptionIndex::size() const
+{
+    return count;
+}
+
+bool SubsumptionIndex::empty() const
+{
+    return count==0;
+}
+
+#endif // SUBSUMPTION_IMP_H
@@ -0,0 +1,94 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+/*!
+    \file "termindex.h"
+
+    \author Nedeljko Stefanovic
+
+    \brief Discrimination tree of terms.
+
+    Terms are stored by their symbols in preorder, with every variable
+    replaced by the same wildcard. Retrieval returns candidates which are
+    unifiable with a query, instances or generalizations of it. Consistency
+    of repeated variables is not checked, so candidates still have to be
+    passed to TermEnvironment::unificator or TermEnvironment::match, but
+    terms with a different symbol at some position are never returned.
+*/
+
+#ifndef TERMINDEX_H
+#define TERMINDEX_H
+
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include "language.h"
+
+class TermIndex
+{
+    struct Node
+    {
+        std::size_t arity;
+        std::unordered_map<uint64_t, std::unique_ptr<Node>> children;
+        std::unique_ptr<Node> variable;
+        std::unordered_map<Term, std::size_t> terms;
+
+        DECLARE Node(std::size_t arity = 0);
+        DECLARE bool empty() const;
+    };
+
+    enum Mode
+    {
+        UNIFIABLE,
+        INSTANCES,
+        GENERALIZATIONS
+    };
+
+    Node root;
+    std::size_t count;
+
+    TermIndex(const TermIndex&) = delete;
+    TermIndex& operator =(const TermIndex&) = delete;
+    DECLARE static void flatten(const Term &term, std::vector<Term> &result, std::vector<std::size_t> &next);
+    DECLARE static void skip(const Node *node, std::size_t remaining, std::vector<const Node*> &result);
+    DECLARE static void retrieve(const Node *node, const std::vector<Term> &query, const std::vector<std::size_t> &next,
+                                 std::size_t position, Mode mode, std::set<Term> &result);
+    DECLARE std::set<Term> retrieve(const Term &query, Mode mode) const;
+
+public:
+    DECLARE TermIndex();
+    DECLARE TermIndex(TermIndex &&other);
+    DECLARE void insert(const Term &term);
+    DECLARE bool remove(const Term &term);
+    DECLARE std::size_t size() const;
+    DECLARE bool empty() const;
+    DECLARE std::set<Term> unifiable(const Term &query) const;
+    DECLARE std::set<Term> instances(const Term &query) const;
+    DECLARE std::set<Term> generalizations(const Term &query) const;
+};
+
+#ifdef INLINE
+
+#include "termindex_imp.h"
+
+#endif
+
+#endif // TERMINDEX_H
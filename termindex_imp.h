@@ -0,0 +1,248 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#ifndef TERMINDEX_IMP_H
+#define TERMINDEX_IMP_H
+
+#include "termindex.h"
+
+TermIndex::Node::Node(std::size_t arity) :
+    arity(arity)
+{
+}
+
+bool TermIndex::Node::empty() const
+{
+    return children.empty() && !variable && terms.empty();
+}
+
+// Appends subterms of term in preorder. For every position, next holds
+// the position following the subterm which starts there.
+void TermIndex::flatten(const Term &term, std::vector<Term> &result, std::vector<std::size_t> &next)
+{
+    std::size_t position = result.size();
+
+    result.push_back(term);
+    next.push_back(0);
+
+    if (term.type() == OPERATION) {
+        for (std::size_t i = 0; i < term.args().size(); ++i) {
+            flatten(term.args()[i], result, next);
+        }
+    }
+
+    next[position] = result.size();
+}
+
+// Collects nodes reached from node by passing over given number of
+// complete terms.
+void TermIndex::skip(const Node *node, std::size_t remaining, std::vector<const Node*> &result)
+{
+    if (remaining == 0) {
+        result.push_back(node);
+
+        return;
+    }
+
+    if (node->variable) {
+        skip(node->variable.get(), remaining - 1, result);
+    }
+
+    for (auto i = node->children.cbegin(); i != node->children.cend(); ++i) {
+        skip(i->second.get(), remaining - 1 + i->second->arity, result);
+    }
+}
+
+void TermIndex::retrieve(const Node *node, const std::vector<Term> &query, const std::vector<std::size_t> &next,
+                         std::size_t position, Mode mode, std::set<Term> &result)
+{
+    if (position == query.size()) {
+        for (auto i = node->terms.cbegin(); i != node->terms.cend(); ++i) {
+            result.insert(i->first);
+        }
+
+        return;
+    }
+
+    const Term &q = query[position];
+
+    if (q.type() == VARIABLE) {
+        if (mode == GENERALIZATIONS) {
+            if (node->variable) {
+                retrieve(node->variable.get(), query, next, position + 1, mode, result);
+            }
+
+            return;
+        }
+
+        std::vector<const Node*> nodes;
+
+        skip(node, 1, nodes);
+
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            retrieve(nodes[i], query, next, position + 1, mode, result);
+        }
+
+        return;
+    }
+
+    auto i = node->children.find(q.id());
+
+    if (i != node->children.cend()) {
+        retrieve(i->second.get(), query, next, position + 1, mode, result);
+    }
+
+    if (mode != INSTANCES && node->variable) {
+        retrieve(node->variable.get(), query, next, next[position], mode, result);
+    }
+}
+
+std::set<Term> TermIndex::retrieve(const Term &query, Mode mode) const
+{
+    std::vector<Term> flat;
+    std::vector<std::size_t> next;
+    std::set<Term> result;
+
+    flatten(query, flat, next);
+    retrieve(&root, flat, next, 0, mode, result);
+
+    return result;
+}
+
+TermIndex::TermIndex() :
+    count(0)
+{
+}
+
+TermIndex::TermIndex(TermIndex &&other) :
+    root(std::move(other.root)),
+    count(other.count)
+{
+    other.count = 0;
+}
+
+void TermIndex::insert(const Term &term)
+{
+    std::vector<Term> flat;
+    std::vector<std::size_t> next;
+    Node *node = &root;
+
+    flatten(term, flat, next);
+
+    for (std::size_t i = 0; i < flat.size(); ++i) {
+        if (flat[i].type() == VARIABLE) {
+            if (!node->variable) {
+                node->variable.reset(new Node);
+            }
+
+            node = node->variable.get();
+        } else {
+            std::unique_ptr<Node> &child = node->children[flat[i].id()];
+
+            if (!child) {
+                child.reset(new Node(flat[i].args().size()));
+            }
+
+            node = child.get();
+        }
+    }
+
+    ++node->terms[term];
+    ++count;
+}
+
+// Removes one occurence of term. Nodes left without terms are destroyed.
+bool TermIndex::remove(const Term &term)
+{
+    std::vector<Term> flat;
+    std::vector<std::size_t> next;
+    std::vector<Node*> path;
+    Node *node = &root;
+
+    flatten(term, flat, next);
+    path.push_back(node);
+
+    for (std::size_t i = 0; i < flat.size(); ++i) {
+        if (flat[i].type() == VARIABLE) {
+            node = node->variable.get();
+        } else {
+            auto j = node->children.find(flat[i].id());
+
+            node = j == node->children.end() ? nullptr : j->second.get();
+        }
+
+        if (node == nullptr) {
+            return false;
+        }
+
+        path.push_back(node);
+    }
+
+    auto k = node->terms.find(term);
+
+    if (k == node->terms.end()) {
+        return false;
+    }
+
+    if (--k->second == 0) {
+        node->terms.erase(k);
+    }
+
+    --count;
+
+    for (std::size_t i = flat.size(); i > 0 && path[i]->empty(); --i) {
+        Node *parent = path[i-1];
+
+        if (flat[i-1].type() == VARIABLE) {
+            parent->variable.reset();
+        } else {
+            parent->children.erase(flat[i-1].id());
+        }
+    }
+
+    return true;
+}
+
+std::size_t TermIndex::size() const
+{
+    return count;
+}
+
+bool TermIndex::empty() const
+{
+    return count == 0;
+}
+
+std::set<Term> TermIndex::unifiable(const Term &query) const
+{
+    return retrieve(query, UNIFIABLE);
+}
+
+std::set<Term> TermIndex::instances(const Term &query) const
+{
+    return retrieve(query, INSTANCES);
+}
+
+std::set<Term> TermIndex::generalizations(const Term &query) const
+{
+    return retrieve(query, GENERALIZATIONS);
+}
+
+#endif // TERMINDEX_IMP_H
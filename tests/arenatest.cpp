@@ -0,0 +1,137 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <memory>
+#include <set>
+#include "../arena.h"
+#include "../language.h"
+#include "../theory.h"
+#include "test.h"
+
+typedef FormulaEnvironment F;
+
+// Terms and formulas made in an arena and obtained again outside of it are
+// promoted, so nothing kept after the arena points into it's chunks.
+void testArenaPromotion()
+{
+    RelationSymbol p(1);
+    ConstantSymbol a;
+    OperationSymbol f(1);
+    OperationSymbol g(2);
+    Variable x;
+    const Term ta(a);
+    const Term tx(x);
+    std::unique_ptr<Term> inArena;
+    std::unique_ptr<Formula> formulaInArena;
+
+    CHECK(ta.isPersistent());
+
+    {
+        NodeArena arena;
+        Term fa(f, TermEnvironment::oneTerm(ta));
+
+        inArena.reset(new Term(g, TermEnvironment::twoTerms(fa, tx)));
+        formulaInArena.reset(new Formula(F::NegationFormula(F::RelationFormula(p, TermEnvironment::oneTerm(*inArena)))));
+
+        CHECK(inArena->isPersistent()==false);
+        CHECK(formulaInArena->isPersistent()==false);
+
+        // A term obtained in a heap scope is persistent, and equal to the
+        // one in the arena.
+        {
+            NodeArena::Heap heap;
+            Term again(g, TermEnvironment::twoTerms(Term(f, TermEnvironment::oneTerm(ta)), tx));
+
+            CHECK(again.isPersistent());
+            CHECK(again==*inArena);
+            CHECK(again.serial()==inArena->serial());
+            CHECK(again.compare(*inArena)==0);
+            CHECK(again.args()[0].isPersistent());
+        }
+
+        // Arguments given directly are promoted as well.
+        {
+            NodeArena::Heap heap;
+            Term outer(f, TermEnvironment::oneTerm(fa));
+
+            CHECK(outer.isPersistent());
+            CHECK(outer.args()[0]==fa);
+            CHECK(outer.args()[0].isPersistent());
+        }
+
+        // The table returns the promoted copy from now on, also in the
+        // arena.
+        CHECK(Term(f, TermEnvironment::oneTerm(ta)).isPersistent());
+    }
+
+    // Lazy data of a persistent formula computed in an arena is persistent.
+    Formula shared = F::NegationFormula(F::DisjunctionFormula(F::RelationFormula(p, TermEnvironment::oneTerm(ta)),
+                                                              F::NegationFormula(F::RelationFormula(p, TermEnvironment::oneTerm(tx)))));
+
+    {
+        NodeArena arena;
+
+        CHECK(shared.uniformType()==ALPHA);
+        CHECK(shared.simplify().isPersistent());
+    }
+
+    for (auto i = shared.uniformArgs().cbegin(); i!=shared.uniformArgs().cend(); ++i) {
+        CHECK(i->isPersistent());
+    }
+
+    // Objects made in an arena stay valid after it.
+    CHECK(inArena->args()[1]==tx);
+    CHECK(formulaInArena->formulas()[0].terms()[0]==*inArena);
+    CHECK(formulaInArena->persistent().isPersistent());
+    CHECK(formulaInArena->persistent()==*formulaInArena);
+}
+
+// A theorem proved in an arena is added to the theory on the heap, so the
+// theory does not keep chunks of the arena alive.
+void testTheoremsOutliveArena()
+{
+    RelationSymbol p(1);
+    RelationSymbol q(1);
+    ConstantSymbol a;
+    Variable x;
+    const Term tx(x);
+    std::set<Formula> axioms;
+
+    axioms.insert(F::UniversalFormula(F::ImplicationFormula(F::RelationFormula(p, TermEnvironment::oneTerm(tx)),
+                                                            F::RelationFormula(q, TermEnvironment::oneTerm(tx))), x));
+
+    Theory theory(axioms);
+
+    {
+        NodeArena arena;
+        const Term ta(a);
+        const Formula formula = F::ImplicationFormula(F::RelationFormula(p, TermEnvironment::oneTerm(ta)),
+                                                      F::RelationFormula(q, TermEnvironment::oneTerm(ta)));
+
+        CHECK(formula.isPersistent()==false);
+        CHECK(theory.draw(formula));
+    }
+
+    CHECK(theory.theorems().size()==2);
+
+    for (auto i = theory.theorems().cbegin(); i!=theory.theorems().cend(); ++i) {
+        CHECK(i->isPersistent());
+    }
+}
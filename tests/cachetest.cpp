@@ -0,0 +1,108 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../language.h"
+#include "test.h"
+
+typedef FormulaEnvironment F;
+
+// Many threads read lazily computed data of the same terms and formulas at
+// the same time. Every thread must see the same values as a serial reader.
+void testConcurrentCaches()
+{
+    RelationSymbol p(1);
+    ConstantSymbol a;
+    OperationSymbol f(1);
+    OperationSymbol g(2);
+    Variable x;
+    Variable y;
+    const Term ta(a);
+    const Term tx(x);
+    const Term ty(y);
+    std::vector<Term> terms;
+    std::vector<Formula> formulas;
+
+    terms.push_back(tx);
+
+    for (int i = 0; i<200; ++i) {
+        const Term &last = terms.back();
+        Term pair(g, TermEnvironment::twoTerms(last, i%2==0 ? ty : ta));
+
+        terms.push_back(Term(f, TermEnvironment::oneTerm(pair)));
+
+        Formula atom = F::RelationFormula(p, TermEnvironment::oneTerm(terms.back()));
+        Formula negated = F::NegationFormula(F::NegationFormula(atom));
+
+        formulas.push_back(F::UniversalFormula(F::DisjunctionFormula(negated, atom), x));
+    }
+
+    const std::size_t threads = 8;
+    std::atomic<int> wrong(0);
+    std::vector<std::thread> workers;
+
+    for (std::size_t k = 0; k<threads; ++k) {
+        workers.push_back(std::thread([&terms, &formulas, &wrong, &x, &y, k]() {
+            for (std::size_t n = 0; n<terms.size(); ++n) {
+                const std::size_t i = (n*(k+1)) % terms.size();
+                const Term &t = terms[i];
+
+                if (t.getFreeVariables().size()!=(i==0 ? 1 : 2) || t.isFreeVariable(x)==false) {
+                    ++wrong;
+                }
+
+                if (i>0 && t.isFreeVariable(y)==false) {
+                    ++wrong;
+                }
+            }
+
+            for (std::size_t n = 0; n<formulas.size(); ++n) {
+                const Formula &formula = formulas[(n*(k+1)) % formulas.size()];
+
+                if (formula.getFreeVariables().size()!=1 || formula.isFreeVariable(x)) {
+                    ++wrong;
+                }
+
+                if (formula.uniformType()!=GAMMA || formula.uniformArgs().size()!=1) {
+                    ++wrong;
+                }
+
+                const Formula simplified = formula.simplify();
+
+                if (simplified.simplify()!=simplified) {
+                    ++wrong;
+                }
+            }
+        }));
+    }
+
+    for (std::size_t k = 0; k<threads; ++k) {
+        workers[k].join();
+    }
+
+    CHECK(wrong==0);
+
+    for (std::size_t i = 0; i<formulas.size(); ++i) {
+        CHECK(formulas[i].simplify()==formulas[i].simplify());
+        CHECK(formulas[i].uniformArgs()[0].uniformType()==BETA);
+    }
+}
@@ -0,0 +1,136 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <iterator>
+#include <set>
+#include <vector>
+#include "../congruence.h"
+#include "../language.h"
+#include "generator.h"
+#include "test.h"
+
+namespace
+{
+    void subterms(const Term &term, std::set<Term> &result)
+    {
+        if (result.insert(term).second) {
+            for (size_t i = 0; i<term.args().size(); ++i) {
+                subterms(term.args()[i], result);
+            }
+        }
+    }
+
+    size_t root(std::vector<size_t> &parent, size_t i)
+    {
+        while (parent[i]!=i) {
+            i = parent[i];
+        }
+
+        return i;
+    }
+}
+
+// The closure must agree with a naive fixpoint which merges two terms with
+// the same symbol whenever their arguments are pairwise equal.
+void testCongruenceClosure()
+{
+    std::vector<Variable> variables(3);
+    TermGenerator generator(variables);
+
+    for (int round = 0; round<100; ++round) {
+        std::vector<Term> listed;
+        std::set<Term> all;
+
+        for (size_t i = 0; i<12; ++i) {
+            listed.push_back(generator.term(1 + generator.next(3)));
+            subterms(listed.back(), all);
+        }
+
+        const std::vector<Term> terms(all.cbegin(), all.cend());
+        std::vector<size_t> parent(terms.size());
+        CongruenceClosure closure;
+
+        for (size_t i = 0; i<terms.size(); ++i) {
+            parent[i] = i;
+        }
+
+        for (size_t i = 0; i<listed.size(); ++i) {
+            closure.add(listed[i]);
+        }
+
+        for (size_t k = 0; k<3; ++k) {
+            const size_t i = generator.next(terms.size());
+            const size_t j = generator.next(terms.size());
+
+            closure.merge(terms[i], terms[j]);
+            parent[root(parent, i)] = root(parent, j);
+        }
+
+        for (bool changed = true; changed; ) {
+            changed = false;
+
+            for (size_t i = 0; i<terms.size(); ++i) {
+                for (size_t j = 0; j<terms.size(); ++j) {
+                    const Term &u = terms[i];
+                    const Term &v = terms[j];
+
+                    if (u.type()!=OPERATION || v.type()!=OPERATION || u.symbol()!=v.symbol() ||
+                        root(parent, i)==root(parent, j)) {
+                        continue;
+                    }
+
+                    bool congruent = true;
+
+                    for (size_t l = 0; congruent && l<u.args().size(); ++l) {
+                        const size_t p = std::distance(all.cbegin(), all.find(u.args()[l]));
+                        const size_t q = std::distance(all.cbegin(), all.find(v.args()[l]));
+
+                        congruent = root(parent, p)==root(parent, q);
+                    }
+
+                    if (congruent) {
+                        parent[root(parent, i)] = root(parent, j);
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        for (size_t i = 0; i<terms.size(); ++i) {
+            for (size_t j = 0; j<terms.size(); ++j) {
+                CHECK(closure.equivalent(terms[i], terms[j])==(root(parent, i)==root(parent, j)));
+            }
+        }
+
+        const std::vector<std::set<Term>> classes = closure.classes();
+        std::set<Term> seen;
+
+        for (size_t i = 0; i<classes.size(); ++i) {
+            for (auto j = classes[i].cbegin(); j!=classes[i].cend(); ++j) {
+                CHECK(seen.insert(*j).second);
+                CHECK(closure.equivalent(*j, *classes[i].cbegin()));
+            }
+        }
+
+        for (size_t i = 0; i<listed.size(); ++i) {
+            CHECK(seen.count(listed[i])==1);
+        }
+    }
+}
@@ -0,0 +1,88 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <vector>
+#include "../language.h"
+#include "../theory.h"
+#include "generator.h"
+#include "test.h"
+
+namespace
+{
+    bool truthValue(const System &system, const std::vector<RelationSymbol> &atoms, unsigned valuation)
+    {
+        for (auto i = system.cbegin(); i!=system.cend(); ++i) {
+            bool result = true;
+
+            for (auto j = i->cbegin(); result && j!=i->cend(); ++j) {
+                result = truthValue(*j, atoms, valuation);
+            }
+
+            if (result) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
+
+// Expansion of a goal to literals gives branches whose disjunction is
+// equivalent to the conjunction of the goal.
+void testExpansion()
+{
+    std::vector<Variable> variables(1);
+    std::vector<RelationSymbol> atoms;
+    TermGenerator generator(variables);
+
+    for (size_t i = 0; i<4; ++i) {
+        atoms.push_back(RelationSymbol(1));
+    }
+
+    FormulaGenerator formulas(generator, atoms, variables[0]);
+
+    for (int n = 0; n<1000; ++n) {
+        Goal goal;
+
+        goal.insert(formulas.formula(1 + n%5));
+        goal.insert(formulas.formula(n%3));
+
+        System system;
+
+        system.insert(goal);
+        systemToLiterals(system);
+
+        for (auto i = system.cbegin(); i!=system.cend(); ++i) {
+            for (auto j = i->cbegin(); j!=i->cend(); ++j) {
+                CHECK(j->uniformType()==LITERAL);
+            }
+        }
+
+        for (unsigned valuation = 0; valuation<(1u << atoms.size()); ++valuation) {
+            bool expected = true;
+
+            for (auto i = goal.cbegin(); i!=goal.cend(); ++i) {
+                expected = expected && truthValue(*i, atoms, valuation);
+            }
+
+            CHECK(truthValue(system, atoms, valuation)==expected);
+        }
+    }
+}
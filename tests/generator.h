@@ -0,0 +1,210 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+/*!
+    \file "generator.h"
+
+    \author Nedeljko Stefanovic
+
+    \brief Deterministic generators of random terms, substitutions and formulas.
+*/
+
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <map>
+#include <vector>
+#include "../language.h"
+
+// Small deterministic generator, so a failure is reproducible.
+class TermGenerator
+{
+    uint64_t state;
+    const std::vector<Variable> &variables;
+    ConstantSymbol a;
+    OperationSymbol f;
+    OperationSymbol g;
+
+public:
+    TermGenerator(const std::vector<Variable> &variables) :
+        state(0x9E3779B97F4A7C15ull),
+        variables(variables),
+        f(1),
+        g(2)
+    {
+    }
+
+    size_t next(size_t bound)
+    {
+        state = state*6364136223846793005ull + 1442695040888963407ull;
+
+        return (state >> 33) % bound;
+    }
+
+    Term term(int depth)
+    {
+        const size_t kind = depth==0 ? next(2) : next(4);
+
+        if (kind==0) {
+            return Term(variables[next(variables.size())]);
+        }
+
+        if (kind==1) {
+            return Term(a);
+        }
+
+        if (kind==2) {
+            return Term(f, TermEnvironment::oneTerm(term(depth-1)));
+        }
+
+        return Term(g, TermEnvironment::twoTerms(term(depth-1), term(depth-1)));
+    }
+
+    Substitution substitution(int depth)
+    {
+        std::map<Variable, Term> valuation;
+
+        for (size_t i = 0; i<variables.size(); ++i) {
+            if (next(2)==0) {
+                valuation.emplace(variables[i], term(depth));
+            }
+        }
+
+        return Substitution(valuation);
+    }
+};
+
+class FormulaGenerator
+{
+    TermGenerator &generator;
+    const std::vector<RelationSymbol> &atoms;
+    const Variable &variable;
+    ConstantSymbol a;
+
+public:
+    FormulaGenerator(TermGenerator &generator, const std::vector<RelationSymbol> &atoms, const Variable &variable) :
+        generator(generator),
+        atoms(atoms),
+        variable(variable)
+    {
+    }
+
+    // Atoms are ground, so a quantifier does not change the truth value.
+    Formula formula(int depth)
+    {
+        const size_t kind = depth==0 ? generator.next(3) : generator.next(11);
+
+        if (kind==0 || kind==1) {
+            return FormulaEnvironment::RelationFormula(atoms[generator.next(atoms.size())], TermEnvironment::oneTerm(Term(a)));
+        }
+
+        if (kind==2) {
+            return generator.next(2)==0 ? Formula(FormulaEnvironment::TrueFormula()) : Formula(FormulaEnvironment::FalseFormula());
+        }
+
+        if (kind<=4) {
+            return FormulaEnvironment::NegationFormula(formula(depth-1));
+        }
+
+        if (kind==5) {
+            return FormulaEnvironment::ConjunctionFormula(formula(depth-1), formula(depth-1));
+        }
+
+        if (kind==6) {
+            return FormulaEnvironment::DisjunctionFormula(formula(depth-1), formula(depth-1));
+        }
+
+        if (kind==7) {
+            return FormulaEnvironment::ImplicationFormula(formula(depth-1), formula(depth-1));
+        }
+
+        if (kind==8) {
+            return FormulaEnvironment::EquivalenceFormula(formula(depth-1), formula(depth-1));
+        }
+
+        if (kind==9) {
+            return FormulaEnvironment::UniversalFormula(formula(depth-1), variable);
+        }
+
+        return FormulaEnvironment::ExistentialFormula(formula(depth-1), variable);
+    }
+};
+
+// Truth value where atom i holds if bit i of valuation is set.
+inline bool truthValue(const Formula &formula, const std::vector<RelationSymbol> &atoms, unsigned valuation)
+{
+    const std::vector<Formula> &args = formula.formulas();
+    bool result;
+
+    switch (formula.type()) {
+    case RELATION:
+        for (size_t i = 0; i<atoms.size(); ++i) {
+            if (formula.symbol()==atoms[i]) {
+                return (valuation >> i) & 1;
+            }
+        }
+
+        return false;
+
+    case TRUE_SYMBOL:
+        return true;
+
+    case FALSE_SYMBOL:
+        return false;
+
+    case NEGATION:
+        return truthValue(args[0], atoms, valuation)==false;
+
+    case CONJUNCTION:
+    case DISJUNCTION:
+        result = formula.type()==CONJUNCTION;
+
+        for (size_t i = 0; i<args.size(); ++i) {
+            if (truthValue(args[i], atoms, valuation)!=result) {
+                return result==false;
+            }
+        }
+
+        return result;
+
+    // A chain of implications, and formulas which are all equivalent.
+    case IMPLICATION:
+    case EQUIVALENCE:
+        for (size_t i = 1; i<args.size(); ++i) {
+            const bool previous = truthValue(args[i-1], atoms, valuation);
+            const bool current = truthValue(args[i], atoms, valuation);
+
+            if (formula.type()==IMPLICATION ? previous && current==false : previous!=current) {
+                return false;
+            }
+        }
+
+        return true;
+
+    case UNIVERSAL:
+    case EXISTENTIAL:
+        return truthValue(args[0], atoms, valuation);
+
+    default:
+        return false;
+    }
+}
+
+#endif // GENERATOR_H
@@ -0,0 +1,160 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+#include <chrono>
+#include <set>
+#include <vector>
+#include "../language.h"
+#include "../prooflimits.h"
+#include "../theory.h"
+#include "test.h"
+
+typedef FormulaEnvironment F;
+
+// Limits which bound nothing are rejected, and a search without end is
+// stopped by its byte limit, which counts systems as well as nodes.
+void testProofLimits()
+{
+    ProofLimits unbounded;
+
+    unbounded.instances = 0;
+
+    bool rejected = false;
+
+    try {
+        ProofControl control(unbounded);
+    }
+    catch (...) {
+        rejected = true;
+    }
+
+    CHECK(rejected);
+
+    RelationSymbol p(1);
+    ConstantSymbol a;
+    OperationSymbol f(1);
+    Variable x;
+    const Term tx(x);
+    const Term fx(f, TermEnvironment::oneTerm(tx));
+    const Formula px = F::RelationFormula(p, TermEnvironment::oneTerm(tx));
+    const Formula pfx = F::RelationFormula(p, TermEnvironment::oneTerm(fx));
+    const Formula pa = F::RelationFormula(p, TermEnvironment::oneTerm(Term(a)));
+    // Not a theorem, every instance of the hypothesis gives a new branch.
+    const Formula formula = F::ImplicationFormula(F::UniversalFormula(F::ImplicationFormula(px, pfx), x), pa);
+    ProofLimits limits;
+
+    limits.instances = 0;
+    limits.bytes = 1 << 20;
+
+    Theory theory((std::set<Formula>()));
+    ProofControl control(limits);
+    const ProofOutcome outcome = theory.draw(formula, control);
+
+    CHECK(outcome.result==UNKNOWN);
+    CHECK(outcome.reason==MEMORY_LIMIT_REACHED);
+    CHECK(control.byteCount()>limits.bytes);
+}
+
+// A goal which needs k instances of a gamma formula in a branch is proved
+// in round k of deepening and not before. Without a control there is one
+// round.
+void testDeepening()
+{
+    RelationSymbol p(1);
+    ConstantSymbol a;
+    OperationSymbol f(1);
+    Variable x;
+    const Term tx(x);
+    const Term fx(f, TermEnvironment::oneTerm(tx));
+    const Term ta(a);
+    const Term fa(f, TermEnvironment::oneTerm(ta));
+    const Term ffa(f, TermEnvironment::oneTerm(fa));
+    const Formula rule = F::UniversalFormula(F::ImplicationFormula(F::RelationFormula(p, TermEnvironment::oneTerm(tx)), F::RelationFormula(p, TermEnvironment::oneTerm(fx))), x);
+    const Formula hypothesis = F::ConjunctionFormula(rule, F::RelationFormula(p, TermEnvironment::oneTerm(ta)));
+    const Formula formula = F::ImplicationFormula(hypothesis, F::RelationFormula(p, TermEnvironment::oneTerm(ffa)));
+    ProofLimits limits;
+
+    limits.instances = 1;
+
+    {
+        Theory theory((std::set<Formula>()));
+        ProofControl control(limits);
+        const ProofOutcome outcome = theory.draw(formula, control);
+
+        CHECK(outcome.result==UNKNOWN);
+        CHECK(outcome.reason==INSTANCE_LIMIT_REACHED);
+    }
+
+    limits.instances = 2;
+
+    {
+        Theory theory((std::set<Formula>()));
+        ProofControl control(limits);
+
+        CHECK(theory.draw(formula, control).result==PROVED);
+    }
+
+    {
+        Theory theory((std::set<Formula>()));
+
+        CHECK(theory.draw(formula)==false);
+    }
+
+    // Without gamma formulas the first round builds the whole system.
+    Theory theory((std::set<Formula>()));
+    ProofControl control(limits);
+    const Formula pa = F::RelationFormula(p, TermEnvironment::oneTerm(ta));
+
+    CHECK(theory.draw(F::ImplicationFormula(pa, F::NegationFormula(pa)), control).result==REFUTED);
+}
+
+// A non-theorem whose second round of deepening runs for minutes is
+// refused at once without a control, as draw from the user interface is.
+void testDrawWithoutControl()
+{
+    RelationSymbol p(1);
+    RelationSymbol q(2);
+    ConstantSymbol a;
+    ConstantSymbol b;
+    OperationSymbol f(1);
+    OperationSymbol g(2);
+    Variable x;
+    Variable y;
+    const Term tx(x);
+    const Term ty(y);
+    const Term fx(f, TermEnvironment::oneTerm(tx));
+    const Term gxy(g, TermEnvironment::twoTerms(tx, ty));
+    const Formula step = F::ImplicationFormula(F::ConjunctionFormula(F::RelationFormula(q, TermEnvironment::twoTerms(tx, ty)),
+                                                                     F::RelationFormula(p, TermEnvironment::oneTerm(tx))),
+                                               F::RelationFormula(p, TermEnvironment::oneTerm(gxy)));
+    const Formula choice = F::DisjunctionFormula(F::RelationFormula(q, TermEnvironment::twoTerms(tx, fx)),
+                                                 F::RelationFormula(q, TermEnvironment::twoTerms(fx, tx)));
+    std::vector<Formula> hypotheses;
+
+    hypotheses.push_back(F::UniversalFormula(F::UniversalFormula(step, y), x));
+    hypotheses.push_back(F::UniversalFormula(choice, x));
+    hypotheses.push_back(F::RelationFormula(p, TermEnvironment::oneTerm(Term(a))));
+
+    const Formula formula = F::ImplicationFormula(F::ConjunctionFormula(hypotheses), F::RelationFormula(p, TermEnvironment::oneTerm(Term(b))));
+    Theory theory((std::set<Formula>()));
+    const auto start = std::chrono::steady_clock::now();
+
+    CHECK(theory.draw(formula)==false);
+    CHECK(std::chrono::steady_clock::now() - start<std::chrono::seconds(5));
+}
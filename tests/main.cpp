@@ -0,0 +1,65 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <iostream>
+#include "test.h"
+
+namespace
+{
+    int failures = 0;
+}
+
+void check(bool condition, const char *text, const char *file, int line)
+{
+    if (condition==false) {
+        ++failures;
+        std::cerr << file << ":" << line << ": check failed: " << text << std::endl;
+    }
+}
+
+int main()
+{
+    testConcurrentCaches();
+    testArenaPromotion();
+    testTheoremsOutliveArena();
+    testSubstitutionComposition();
+    testUnificationAgainstNaive();
+    testMatching();
+    testTermIndex();
+    testSimplify();
+    testExpansion();
+    testSubsumption();
+    testCongruenceClosure();
+    testParallelSearch();
+    testProofLimits();
+    testDeepening();
+    testDrawWithoutControl();
+    testTranspositionTable();
+
+    if (failures>0) {
+        std::cerr << failures << " checks failed" << std::endl;
+
+        return 1;
+    }
+
+    std::cout << "All checks passed" << std::endl;
+
+    return 0;
+}
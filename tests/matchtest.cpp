@@ -0,0 +1,93 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <set>
+#include <vector>
+#include "../language.h"
+#include "../theory.h"
+#include "test.h"
+
+typedef FormulaEnvironment F;
+
+// Matching binds variables of the pattern only, accepts variants of
+// closed formulas and never binds a free variable to a bound one.
+void testMatching()
+{
+    RelationSymbol p(1);
+    RelationSymbol r(2);
+    ConstantSymbol a;
+    OperationSymbol g(2);
+    Variable x;
+    Variable y;
+    Variable z;
+    const Term ta(a);
+    const Term tx(x);
+    const Term ty(y);
+    const Term tz(z);
+    const Term gxx(g, TermEnvironment::twoTerms(tx, tx));
+    const Term gaa(g, TermEnvironment::twoTerms(ta, ta));
+    const Term gay(g, TermEnvironment::twoTerms(ta, ty));
+    bool ok;
+
+    const Substitution s1 = TermEnvironment::matcher(gxx, gaa, ok);
+    CHECK(ok && gxx[s1]==gaa);
+    TermEnvironment::matcher(gxx, gay, ok);
+    CHECK(ok==false);
+    TermEnvironment::matcher(gaa, gxx, ok);
+    CHECK(ok==false);
+
+    const Formula px = F::RelationFormula(p, TermEnvironment::oneTerm(tx));
+    const Formula py = F::RelationFormula(p, TermEnvironment::oneTerm(ty));
+    const Formula all = F::UniversalFormula(px, x);
+    const Formula variant = F::UniversalFormula(py, y);
+
+    CHECK(all!=variant);
+    FormulaEnvironment::matcher(all, variant, ok);
+    CHECK(ok);
+    FormulaEnvironment::matcher(variant, all, ok);
+    CHECK(ok);
+
+    const Formula rzx = F::RelationFormula(r, TermEnvironment::twoTerms(tz, tx));
+    const Formula rxx = F::RelationFormula(r, TermEnvironment::twoTerms(tx, tx));
+    const Formula ryy = F::RelationFormula(r, TermEnvironment::twoTerms(ty, ty));
+
+    // z would have to be bound to the bound variable of the target.
+    FormulaEnvironment::matcher(F::UniversalFormula(rzx, x), F::UniversalFormula(rxx, x), ok);
+    CHECK(ok==false);
+    const Substitution s2 = FormulaEnvironment::matcher(F::UniversalFormula(rzx, x), F::UniversalFormula(F::RelationFormula(r, TermEnvironment::twoTerms(ta, ty)), y), ok);
+    CHECK(ok && s2(z)==ta && s2.find(x)==nullptr);
+    CHECK(F::UniversalFormula(rzx, x)[s2]==F::UniversalFormula(F::RelationFormula(r, TermEnvironment::twoTerms(ta, tx)), x));
+    FormulaEnvironment::matcher(F::UniversalFormula(rxx, x), F::UniversalFormula(ryy, y), ok);
+    CHECK(ok);
+
+    std::set<Formula> axioms;
+
+    axioms.insert(all);
+    axioms.insert(F::ImplicationFormula(rzx, px));
+
+    Theory theory(axioms);
+
+    CHECK(theory.contains(all));
+    CHECK(theory.contains(variant));
+    CHECK(theory.contains(F::ImplicationFormula(F::RelationFormula(r, TermEnvironment::twoTerms(ta, gay)), F::RelationFormula(p, TermEnvironment::oneTerm(gay)))));
+    CHECK(theory.contains(F::ImplicationFormula(rzx, py))==false);
+    CHECK(theory.contains(F::ExistentialFormula(px, x))==false);
+    CHECK(theory.contains(px)==false);
+}
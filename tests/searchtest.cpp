@@ -0,0 +1,77 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <vector>
+#include "../language.h"
+#include "../theory.h"
+#include "generator.h"
+#include "test.h"
+
+// A propositional goal is contradictory exactly when no valuation
+// satisfies it, and a search on a pool of threads must find the same.
+void testParallelSearch()
+{
+    std::vector<Variable> variables(1);
+    std::vector<RelationSymbol> atoms;
+    TermGenerator generator(variables);
+
+    for (size_t i = 0; i<3; ++i) {
+        atoms.push_back(RelationSymbol(1));
+    }
+
+    FormulaGenerator formulas(generator, atoms, variables[0]);
+    size_t contradictory = 0;
+
+    for (int n = 0; n<300; ++n) {
+        Goal goal;
+
+        for (int k = 0; k<3; ++k) {
+            goal.insert(formulas.formula(1 + n%4));
+        }
+
+        bool satisfiable = false;
+
+        for (unsigned valuation = 0; valuation<(1u << atoms.size()); ++valuation) {
+            bool value = true;
+
+            for (auto i = goal.cbegin(); value && i!=goal.cend(); ++i) {
+                value = truthValue(*i, atoms, valuation);
+            }
+
+            satisfiable = satisfiable || value;
+        }
+
+        System system;
+
+        system.insert(goal);
+
+        const bool serial = concludeContradiction(system);
+
+        CHECK(serial==(satisfiable==false));
+        CHECK(concludeContradiction(system, 4)==serial);
+
+        if (serial) {
+            ++contradictory;
+        }
+    }
+
+    CHECK(contradictory>0);
+    CHECK(contradictory<300);
+}
@@ -0,0 +1,59 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <vector>
+#include "../language.h"
+#include "generator.h"
+#include "test.h"
+
+// Simplification must keep the truth value under every valuation of the
+// atoms, and a simplified formula must be its own simplification.
+void testSimplify()
+{
+    std::vector<Variable> variables(1);
+    std::vector<RelationSymbol> atoms;
+    TermGenerator generator(variables);
+
+    for (size_t i = 0; i<3; ++i) {
+        atoms.push_back(RelationSymbol(1));
+    }
+
+    FormulaGenerator formulas(generator, atoms, variables[0]);
+
+    for (int n = 0; n<2000; ++n) {
+        const Formula formula = formulas.formula(1 + n%5);
+        const Formula simplified = formula.simplify();
+
+        CHECK(simplified.simplify()==simplified);
+        CHECK(formula.simplify()==simplified);
+
+        for (unsigned valuation = 0; valuation<(1u << atoms.size()); ++valuation) {
+            CHECK(truthValue(simplified, atoms, valuation)==truthValue(formula, atoms, valuation));
+        }
+
+        const Formula negated = FormulaEnvironment::NegationFormula(formula).simplify();
+
+        CHECK(negated.simplify()==negated);
+
+        for (unsigned valuation = 0; valuation<(1u << atoms.size()); ++valuation) {
+            CHECK(truthValue(negated, atoms, valuation)!=truthValue(formula, atoms, valuation));
+        }
+    }
+}
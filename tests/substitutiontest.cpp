@@ -0,0 +1,62 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <vector>
+#include "../language.h"
+#include "generator.h"
+#include "test.h"
+
+// Composition s[o] applies o first and s then, so t[s[o]] must equal
+// t[o][s]. The flat representation must stay sorted by variable id.
+void testSubstitutionComposition()
+{
+    std::vector<Variable> variables(6);
+    TermGenerator terms(variables);
+    const Substitution identity;
+
+    for (int n = 0; n<500; ++n) {
+        const Substitution s = terms.substitution(2);
+        const Substitution o = terms.substitution(2);
+        const Substitution r = terms.substitution(1);
+        const Substitution so = s[o];
+        const Term t = terms.term(4);
+
+        CHECK(t[so]==t[o][s]);
+        CHECK(t[r[so]]==t[r[s][o]]);
+        CHECK(t[r[so]]==t[o][s][r]);
+        CHECK(t[identity[s]]==t[s]);
+        CHECK(t[s[identity]]==t[s]);
+        CHECK(so.size()<=s.size()+o.size());
+
+        for (size_t i = 1; i<so.data.size(); ++i) {
+            CHECK(so.data[i-1].first.id<so.data[i].first.id);
+        }
+
+        for (size_t i = 0; i<variables.size(); ++i) {
+            const Term single(variables[i]);
+
+            CHECK(so(variables[i])==single[o][s]);
+            CHECK((o.find(variables[i])!=nullptr)==o.affects(single.getFreeVariables()));
+        }
+    }
+
+    CHECK(identity.empty());
+    CHECK(identity[identity].empty());
+}
@@ -0,0 +1,119 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <algorithm>
+#include <vector>
+#include "../language.h"
+#include "../theory.h"
+#include "../subsumption.h"
+#include "generator.h"
+#include "test.h"
+
+// removeSupergoals and a subsumption index fed in any order must keep
+// exactly the goals which do not include another goal.
+void testSubsumption()
+{
+    std::vector<Variable> variables(1);
+    TermGenerator generator(variables);
+    std::vector<Formula> literals;
+    const Term a((ConstantSymbol()));
+
+    for (size_t i = 0; i<12; ++i) {
+        literals.push_back(FormulaEnvironment::RelationFormula(RelationSymbol(1), TermEnvironment::oneTerm(a)));
+    }
+
+    for (int round = 0; round<50; ++round) {
+        System system;
+        const size_t goals = 1 + generator.next(200);
+
+        for (size_t k = 0; k<goals; ++k) {
+            Goal goal;
+            const size_t size = 1 + generator.next(6);
+
+            for (size_t l = 0; l<size; ++l) {
+                goal.insert(literals[generator.next(literals.size())]);
+            }
+
+            system.insert(goal);
+        }
+
+        System expected;
+
+        for (auto i = system.cbegin(); i!=system.cend(); ++i) {
+            bool included = false;
+
+            for (auto j = system.cbegin(); included==false && j!=system.cend(); ++j) {
+                included = cmp(*i, *j)>0;
+            }
+
+            if (included==false) {
+                expected.insert(*i);
+            }
+        }
+
+        System pruned = system;
+
+        removeSupergoals(pruned);
+        CHECK(pruned==expected);
+
+        std::vector<const Goal*> order;
+
+        for (auto i = system.cbegin(); i!=system.cend(); ++i) {
+            order.push_back(&*i);
+        }
+
+        for (size_t i = order.size(); i>1; --i) {
+            std::swap(order[i-1], order[generator.next(i)]);
+        }
+
+        SubsumptionIndex index;
+        std::vector<const Goal*> kept;
+
+        for (auto i = order.cbegin(); i!=order.cend(); ++i) {
+            std::vector<const Goal*> removed;
+
+            if (index.add(**i, removed)) {
+                kept.push_back(*i);
+            }
+
+            for (auto j = removed.cbegin(); j!=removed.cend(); ++j) {
+                kept.erase(std::find(kept.begin(), kept.end(), *j));
+            }
+        }
+
+        System result;
+
+        for (auto i = kept.cbegin(); i!=kept.cend(); ++i) {
+            result.insert(**i);
+        }
+
+        CHECK(result==expected);
+        CHECK(index.size()==expected.size());
+        CHECK(index.add(*order[0])==false);
+
+        const Goal empty;
+        std::vector<const Goal*> removed;
+
+        CHECK(index.add(empty, removed));
+        CHECK(removed.size()==expected.size());
+        CHECK(index.size()==1);
+        CHECK(index.add(*order[0])==false);
+    }
+}
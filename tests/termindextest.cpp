@@ -0,0 +1,121 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <set>
+#include <vector>
+#include "../language.h"
+#include "../termindex.h"
+#include "generator.h"
+#include "test.h"
+
+namespace
+{
+    // Every occurence of a variable replaced by a new variable from fresh,
+    // starting at used. The index does not tell variables apart, so its
+    // answers are exact for such terms.
+    Term linear(const Term &term, const std::vector<Variable> &fresh, size_t &used)
+    {
+        if (term.type()==VARIABLE) {
+            return Term(fresh[used++]);
+        }
+
+        if (term.args().empty()) {
+            return term;
+        }
+
+        std::vector<Term> args;
+
+        for (size_t i = 0; i<term.args().size(); ++i) {
+            args.push_back(linear(term.args()[i], fresh, used));
+        }
+
+        return Term(term.symbol(), std::move(args));
+    }
+}
+
+// Retrieval must return exactly the terms which unify with, are instances
+// of or generalize the query once repeated variables are told apart.
+void testTermIndex()
+{
+    std::vector<Variable> variables(3);
+    std::vector<Variable> fresh(64);
+    TermGenerator terms(variables);
+    TermIndex index;
+    std::vector<Term> all;
+
+    for (int n = 0; n<300; ++n) {
+        all.push_back(terms.term(n%5));
+        index.insert(all.back());
+    }
+
+    CHECK(index.size()==all.size());
+
+    size_t filtered = 0;
+
+    for (int n = 0; n<200; ++n) {
+        const Term query = terms.term(n%4);
+        std::set<Term> unifiable;
+        std::set<Term> instances;
+        std::set<Term> generalizations;
+
+        for (size_t i = 0; i<all.size(); ++i) {
+            size_t used = 0;
+            const Term q = linear(query, fresh, used);
+            const Term t = linear(all[i], fresh, used);
+            bool ok;
+
+            TermEnvironment::unificator(q, t, ok);
+
+            if (ok) {
+                unifiable.insert(all[i]);
+            }
+
+            TermEnvironment::matcher(q, all[i], ok);
+
+            if (ok) {
+                instances.insert(all[i]);
+            }
+
+            TermEnvironment::matcher(t, query, ok);
+
+            if (ok) {
+                generalizations.insert(all[i]);
+            }
+        }
+
+        CHECK(index.unifiable(query)==unifiable);
+        CHECK(index.instances(query)==instances);
+        CHECK(index.generalizations(query)==generalizations);
+
+        if (unifiable.size()<all.size()/2) {
+            ++filtered;
+        }
+    }
+
+    CHECK(filtered>0);
+
+    for (size_t i = 0; i<all.size(); ++i) {
+        CHECK(index.remove(all[i]));
+    }
+
+    CHECK(index.empty());
+    CHECK(index.remove(all[0])==false);
+    CHECK(index.unifiable(Term(variables[0])).empty());
+}
@@ -0,0 +1,56 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+/*!
+    \file "test.h"
+
+    \author Nedeljko Stefanovic
+
+    \brief Checks and test functions of the prover core.
+
+    A failed check is reported with it's file and line and the tests go on.
+    The test program returns nonzero if any check failed.
+*/
+
+#ifndef TEST_H
+#define TEST_H
+
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+void check(bool condition, const char *text, const char *file, int line);
+
+void testConcurrentCaches();
+void testArenaPromotion();
+void testTheoremsOutliveArena();
+void testSubstitutionComposition();
+void testUnificationAgainstNaive();
+void testMatching();
+void testTermIndex();
+void testSimplify();
+void testExpansion();
+void testSubsumption();
+void testCongruenceClosure();
+void testParallelSearch();
+void testProofLimits();
+void testDeepening();
+void testDrawWithoutControl();
+void testTranspositionTable();
+
+#endif // TEST_H
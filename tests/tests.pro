@@ -0,0 +1,49 @@
+#-------------------------------------------------
+#
+# Tests of the prover core, without the user interface.
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = tests
+TEMPLATE = app
+CONFIG += console c++11 thread
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    ../arena.cpp \
+    ../congruence.cpp \
+    ../dictionary.cpp \
+    ../disequality.cpp \
+    ../formulaset.cpp \
+    ../goalbits.cpp \
+    ../language.cpp \
+    ../prooflimits.cpp \
+    ../readwrite.cpp \
+    ../subsumption.cpp \
+    ../utility.cpp \
+    ../termindex.cpp \
+    ../theory.cpp \
+    ../transposition.cpp \
+    ../workpool.cpp \
+    main.cpp \
+    cachetest.cpp \
+    arenatest.cpp \
+    substitutiontest.cpp \
+    unificationtest.cpp \
+    matchtest.cpp \
+    termindextest.cpp \
+    simplifytest.cpp \
+    expansiontest.cpp \
+    subsumptiontest.cpp \
+    congruencetest.cpp \
+    searchtest.cpp \
+    limitstest.cpp \
+    transpositiontest.cpp
+
+HEADERS  += \
+    generator.h \
+    test.h
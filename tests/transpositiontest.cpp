@@ -0,0 +1,107 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+#include <vector>
+#include "../language.h"
+#include "../prooflimits.h"
+#include "../transposition.h"
+#include "test.h"
+
+typedef FormulaEnvironment F;
+
+// Systems which differ only in names of variables are found, others are
+// not, and the table keeps within it's bytes and reports them.
+void testTranspositionTable()
+{
+    RelationSymbol p(1);
+    RelationSymbol r(2);
+    ConstantSymbol a;
+    OperationSymbol f(1);
+    Variable x;
+    Variable y;
+    const Term ta(a);
+    const Term tx(x);
+    const Term ty(y);
+    const Formula notPa = F::NegationFormula(F::RelationFormula(p, TermEnvironment::oneTerm(ta)));
+    Goal g1;
+    Goal g2;
+    Goal g3;
+
+    g1.insert(F::RelationFormula(r, TermEnvironment::twoTerms(tx, ta)));
+    g1.insert(F::RelationFormula(p, TermEnvironment::oneTerm(tx)));
+    g1.insert(notPa);
+    g2.insert(F::RelationFormula(r, TermEnvironment::twoTerms(ty, ta)));
+    g2.insert(F::RelationFormula(p, TermEnvironment::oneTerm(ty)));
+    g2.insert(notPa);
+    g3.insert(F::RelationFormula(r, TermEnvironment::twoTerms(tx, ta)));
+    g3.insert(F::RelationFormula(p, TermEnvironment::oneTerm(ty)));
+    g3.insert(notPa);
+
+    System s1;
+    System s2;
+    System s3;
+    System s4;
+
+    s1.insert(g1);
+    s2.insert(g2);
+    s3.insert(g3);
+    s4.insert(Goal{F::UniversalFormula(F::RelationFormula(p, TermEnvironment::oneTerm(tx)), x)});
+
+    ProofControl control;
+    ProofControl::Scope scope(&control);
+
+    {
+        TranspositionTable table;
+
+        CHECK(table.visit(s1)==false);
+        CHECK(table.visit(s2));
+        CHECK(table.visit(s3)==false);
+        CHECK(table.visit(s1));
+        // Only systems of literals are stored.
+        CHECK(table.visit(s4)==false);
+        CHECK(table.visit(s4)==false);
+        CHECK(table.size()==2);
+        CHECK(control.transpositionLookups()==4);
+        CHECK(control.transpositionHits()==2);
+    }
+
+    const std::size_t before = control.byteCount();
+    TranspositionTable table(1024);
+    std::vector<Term> terms(1, ta);
+
+    for (int i = 0; i<100; ++i) {
+        System system;
+
+        system.insert(Goal{F::RelationFormula(p, TermEnvironment::oneTerm(terms.back()))});
+        CHECK(table.visit(system)==false);
+        CHECK(table.visit(system));
+        terms.push_back(Term(f, TermEnvironment::oneTerm(terms.back())));
+    }
+
+    CHECK(table.size()>0);
+    CHECK(table.size()<100);
+    CHECK(control.byteCount()>before);
+    CHECK(control.byteCount()-before<=1024);
+
+    // The oldest systems were evicted.
+    System first;
+
+    first.insert(Goal{F::RelationFormula(p, TermEnvironment::oneTerm(ta))});
+    CHECK(table.visit(first)==false);
+}
@@ -0,0 +1,84 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <vector>
+#include "../language.h"
+#include "generator.h"
+#include "test.h"
+
+namespace
+{
+    // Images of all the variables under a substitution, as one term.
+    Term images(const OperationSymbol &tuple, const std::vector<Variable> &variables, const Substitution &substitution)
+    {
+        std::vector<Term> args;
+
+        for (size_t i = 0; i<variables.size(); ++i) {
+            args.push_back(Term(variables[i])[substitution]);
+        }
+
+        return Term(tuple, std::move(args));
+    }
+}
+
+// The union-find unificator must agree with the naive one on every problem,
+// and both unificators must be most general, so each one is an instance of
+// the other. Fingerprints may not reject a unifiable pair.
+void testUnificationAgainstNaive()
+{
+    std::vector<Variable> variables(4);
+    const OperationSymbol tuple(variables.size());
+    TermGenerator terms(variables);
+    size_t unifiable = 0;
+
+    for (int n = 0; n<3000; ++n) {
+        const Term u = terms.term(4);
+        const Term v = n%3==0 ? u[terms.substitution(2)] : terms.term(4);
+        bool ok1;
+        bool ok2;
+        const Substitution s1 = TermEnvironment::unificator(u, v, ok1);
+        const Substitution s2 = TermEnvironment::naiveUnificator(u, v, ok2);
+
+        CHECK(ok1==ok2);
+        CHECK(ok2==false || u.fingerprint().unifiable(v.fingerprint()));
+
+        if (ok1==false || ok2==false) {
+            continue;
+        }
+
+        ++unifiable;
+
+        CHECK(u[s1]==v[s1]);
+        CHECK(u[s1][s1]==u[s1]);
+        CHECK(u[s2]==v[s2]);
+
+        const Term i1 = images(tuple, variables, s1);
+        const Term i2 = images(tuple, variables, s2);
+        bool general1;
+        bool general2;
+
+        TermEnvironment::matcher(i1, i2, general1);
+        TermEnvironment::matcher(i2, i1, general2);
+        CHECK(general1 && general2);
+    }
+
+    CHECK(unifiable>1000);
+    CHECK(unifiable<3000);
+}
@@ -1,8 +1,22 @@
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include "arena.h"
+#include "congruence.h"
+#include "disequality.h"
+#include "error.h"
+#include "formulaset.h"
+#include "prooflimits.h"
+#include "subsumption.h"
 #include "theory.h"
 
 #include <iostream>
 #include "readwrite.h"
+#include "termindex.h"
+#include "transposition.h"
+#include "workpool.h"
 using namespace std;
 
 typedef std::set<Formula> Goal;
@@ -77,34 +91,44 @@ int cmp(const Goal &g1, const Goal &g2)
     return 0;
 }
 
-void removeSupergoals(System &goals)
+// A node of std::set holds three pointers and a color besides its value.
+std::size_t goalBytes(const Goal &goal)
 {
-    while (true) {
-        bool changed = false;
+    return sizeof(Goal) + goal.size()*(4*sizeof(void*) + sizeof(Formula));
+}
 
-        for (auto i = goals.cbegin(); i!=goals.cend(); ++i) {
-            auto j = i;
-            const Goal &goal1  = *i;
+std::size_t systemBytes(const System &system)
+{
+    std::size_t result = sizeof(System);
 
-            for (++j; j!=goals.cend(); ++j) {
-                const Goal &goal2 = *j;
-                int result = cmp(goal1, goal2);
+    for (auto i = system.cbegin(); i!=system.cend(); ++i) {
+        result += 4*sizeof(void*) + goalBytes(*i);
+    }
 
-                if (result!=0) {
-                    changed = true;
-                    goals.erase(result>0 ? i : j);
+    return result;
+}
 
-                    break;
-                }
-            }
+// Leaves only goals which do not include some other goal. Goals are added
+// to a subsumption index by size, so an added goal never removes a kept
+// one and goals rejected by the index can be erased in the same pass.
+void removeSupergoals(System &goals)
+{
+    std::vector<System::const_iterator> bySize;
 
-            if (changed) {
-                break;
-            }
-        }
+    for (auto i = goals.cbegin(); i!=goals.cend(); ++i) {
+        bySize.push_back(i);
+    }
 
-        if (changed==false) {
-            break;
+    std::stable_sort(bySize.begin(), bySize.end(),
+                     [](const System::const_iterator &first, const System::const_iterator &second) {
+        return first->size()<second->size();
+    });
+
+    SubsumptionIndex index;
+
+    for (auto i = bySize.cbegin(); i!=bySize.cend(); ++i) {
+        if (index.add(**i)==false) {
+            goals.erase(*i);
         }
     }
 }
@@ -124,211 +148,322 @@ void tryNone(System &goals)
     }
 }
 
-bool tryLiteral(System &goals)
+// State of one branch while a goal is expanded to literals. Formulas
+// waiting for a rule are in pending, beta formulas wait in betas until
+// nothing else is pending, so rules are applied in the same order as
+// literal, alpha, gamma and delta before beta. Formulas already added to
+// the branch are in seen and are not expanded twice. Sets are persistent,
+// so branches made by a split share them. Gamma formulas stay parked in
+// gammas with the number of their instances in the branch.
+struct GoalExpansion
 {
-    for (auto i = goals.cbegin(); i!=goals.cend(); ++i) {
-        const Goal &goal = *i;
+    FormulaSet literals;
+    FormulaSet seen;
+    std::vector<Formula> pending;
+    FormulaSet betas;
+    std::map<Formula, std::size_t> gammas;
+
+    void add(const Formula &formula)
+    {
+        if (seen.insert(formula)) {
+            pending.push_back(formula);
+        }
+    }
+};
 
-        for (auto j = goal.cbegin(); j!=goal.cend(); ++j) {
-            const Formula &formula = *j;
-            std::vector<Formula> args;
-            std::set<Variable> vars;
-            UniformType type = formula.uniformType(args, vars);
+// Instance of gamma formula with fresh variables, or of delta formula with
+// fresh constants.
+Formula freshInstance(const Formula &formula)
+{
+    const std::set<Variable> &vars = formula.uniformVariables();
+    std::map<Variable, Term> sub;
+
+    for (auto k = vars.cbegin(); k!=vars.cend(); ++k) {
+        if (formula.uniformType()==GAMMA) {
+            sub.insert(std::pair<Variable, Term>(*k, Term(Variable())));
+        } else {
+            sub.insert(std::pair<Variable, Term>(*k, Term(ConstantSymbol())));
+        }
+    }
 
-            if (type==LITERAL) {
-                const Formula &f = args[0];
+    Substitution subst(sub);
 
-                if (f.type()==NONE_SYMBOL) {
-                    throw(1);
-                }
+    return formula.uniformArgs()[0][subst];
+}
 
-                if (f.type()==FALSE_SYMBOL) {
-                    goals.erase(i);
+// Returns false if the branch is closed by a false literal.
+bool expandPending(GoalExpansion &e)
+{
+    while (e.pending.empty()==false) {
+        const Formula formula = e.pending.back();
 
-                    return true;
-                }
+        e.pending.pop_back();
+        ProofControl::node();
 
-                if (f.type()==TRUE_SYMBOL) {
-                    Goal g = goal;
+        switch (formula.uniformType()) {
+        case LITERAL:
+        {
+            const Formula f = formula.literal();
 
-                    g.erase(*j);
-                    goals.erase(i);
-                    goals.insert(g);
+            if (f.type()==NONE_SYMBOL) {
+                throw(1);
+            }
 
-                    return true;
-                }
+            if (f.type()==FALSE_SYMBOL) {
+                return false;
+            }
 
-                if (f!=formula) {
-                    Goal g = goal;
+            if (f.type()==TRUE_SYMBOL) {
+                break;
+            }
 
-                    g.erase(*j);
-                    g.insert(f);
-                    goals.erase(i);
-                    goals.insert(g);
+            if (f!=formula) {
+                e.add(f);
+            } else {
+                e.literals.insert(f);
+            }
 
-                    return true;
-                }
+            break;
+        }
+
+        case ALPHA:
+        {
+            const std::vector<Formula> &args = formula.uniformArgs();
+
+            for (size_t i = 0; i<args.size(); ++i) {
+                e.add(args[i]);
             }
+
+            break;
+        }
+
+        case GAMMA:
+            e.add(freshInstance(formula));
+            e.gammas[formula] = 1;
+
+            break;
+
+        case DELTA:
+            e.add(freshInstance(formula));
+
+            break;
+
+        case BETA:
+            e.betas.insert(formula);
+
+            break;
+
+        default:
+            e.literals.insert(formula);
+
+            break;
         }
     }
 
-    return false;
+    return true;
 }
 
-bool tryAlphaGamaDelta(System &goals)
+// Adds one more instance of every parked gamma formula with less than
+// budget.instances instances. Returns false when none is added. A gamma
+// formula at the budget in an open branch is recorded in budget.exhausted,
+// since another instance might close the branch.
+bool instantiateParked(GoalExpansion &e, GammaBudget &budget)
 {
-    for (auto i = goals.cbegin(); i!=goals.cend(); ++i) {
-        const Goal &goal = *i;
-
-        for (auto j = goal.cbegin(); j!=goal.cend(); ++j) {
-            const Formula &formula = *j;
-            std::vector<Formula> args;
-            std::set<Variable> vars;
-            UniformType type = formula.uniformType(args, vars);
+    bool added = false;
+
+    for (auto i = e.gammas.begin(); i!=e.gammas.end(); ++i) {
+        if (i->second<budget.instances) {
+            e.add(freshInstance(i->first));
+            ++i->second;
+            added = true;
+        } else {
+            budget.exhausted = true;
+        }
+    }
 
-            if (type==ALPHA) {
-                Goal g = goal;
+    return added;
+}
 
-                g.erase(*j);
+// Expands branches until each one is closed or has only literals and
+// parked gamma formulas left, open branches are appended to open. Gamma
+// formulas are instantiated again only when nothing else is left in a
+// branch, so every branch of a split gets it's own instances.
+void expandBranches(std::vector<GoalExpansion> &branches, std::vector<GoalExpansion> &open, GammaBudget &budget)
+{
+    while (branches.empty()==false) {
+        GoalExpansion e = std::move(branches.back());
+        bool isOpen = true;
 
-                for (size_t i = 0; i<args.size(); ++i) {
-                    g.insert(args[i]);
-                }
+        branches.pop_back();
 
-                goals.erase(i);
-                goals.insert(g);
+        do {
+            while ((isOpen = expandPending(e)) && e.betas.empty()==false) {
+                const Formula beta = e.betas.first();
+                const std::vector<Formula> &args = beta.uniformArgs();
 
-                return true;
-            }
+                e.betas.erase(beta);
 
-            if (type==GAMMA) {
-                Goal g = goal;
+                for (size_t i = 1; i<args.size(); ++i) {
+                    branches.push_back(e);
+                    branches.back().add(args[i]);
+                }
 
-                g.erase(*j);
+                e.add(args[0]);
+            }
+        } while (isOpen && instantiateParked(e, budget));
 
-                std::map<Variable, Term> sub;
+        if (isOpen) {
+            open.push_back(std::move(e));
+        }
+    }
+}
 
-                for (auto k = vars.cbegin(); k!=vars.cend(); ++k) {
-                    sub.insert(std::pair<Variable, Term>(*k, Term(Variable())));
-                }
+// Whether expansion would leave goal as it is.
+bool isExpanded(const Goal &goal)
+{
+    for (auto i = goal.cbegin(); i!=goal.cend(); ++i) {
+        const Formula &formula = *i;
 
-                Substitution subst(sub);
+        if (formula.uniformType()!=LITERAL || formula.literal()!=formula) {
+            return false;
+        }
 
-                g.insert(args[0][subst]);
-                goals.erase(i);
-                goals.insert(g);
+        switch (formula.type()) {
+        case NONE_SYMBOL:
+        case FALSE_SYMBOL:
+        case TRUE_SYMBOL:
+            return false;
 
-                return true;
-            }
+        default:
+            break;
+        }
+    }
 
-            if (type==DELTA) {
-                Goal g = goal;
+    return true;
+}
 
-                g.erase(*j);
+// Adds goal to result unless it includes a goal of result, and erases
+// goals of result which include it.
+void keepGoal(Goal &&goal, System &result, SubsumptionIndex &index)
+{
+    auto inserted = result.insert(std::move(goal));
 
-                std::map<Variable, Term> sub;
+    if (inserted.second==false) {
+        return;
+    }
 
-                for (auto k = vars.cbegin(); k!=vars.cend(); ++k) {
-                    sub.insert(std::pair<Variable, Term>(*k, Term(ConstantSymbol())));
-                }
+    ProofControl::allocated(4*sizeof(void*) + goalBytes(*inserted.first));
 
-                Substitution subst(sub);
+    std::vector<const Goal*> removed;
 
-                g.insert(args[0][subst]);
-                goals.erase(i);
-                goals.insert(g);
+    if (index.add(*inserted.first, removed)==false) {
+        result.erase(inserted.first);
 
-                return true;
-            }
-        }
+        return;
     }
 
-    return false;
+    for (auto i = removed.cbegin(); i!=removed.cend(); ++i) {
+        result.erase(result.find(**i));
+    }
 }
 
-bool tryBeta(System &goals)
+// Goals given by draw and most goals made by substitution are expanded
+// already, they are passed as they are.
+void expandGoal(const Goal &goal, System &result, SubsumptionIndex &index, GammaBudget &budget)
 {
-    for (auto i = goals.cbegin(); i!=goals.cend(); ++i) {
-        const Goal &goal = *i;
+    if (isExpanded(goal)) {
+        ProofControl::node();
+        keepGoal(Goal(goal), result, index);
 
-        for (auto j = goal.cbegin(); j!=goal.cend(); ++j) {
-            const Formula &formula = *j;
-            std::vector<Formula> args;
-            std::set<Variable> vars;
-            UniformType type = formula.uniformType(args, vars);
+        return;
+    }
 
-            if (type==BETA) {
-                Goal g = goal;
+    std::vector<GoalExpansion> branches(1);
+    std::vector<GoalExpansion> open;
 
-                g.erase(*j);
-                goals.erase(i);
+    for (auto i = goal.cbegin(); i!=goal.cend(); ++i) {
+        branches[0].add(*i);
+    }
 
-                for (size_t i = 0; i<args.size(); ++i) {
-                    Goal newGoal = g;
+    expandBranches(branches, open, budget);
 
-                    newGoal.insert(args[i]);
-                    goals.insert(newGoal);
-                }
+    for (auto i = open.cbegin(); i!=open.cend(); ++i) {
+        keepGoal(i->literals.toSet(), result, index);
+    }
+}
 
-                return true;
-            }
-        }
+// Theorems expanded by every rule but beta, so nothing is split before a
+// goal is added. Null pointer when a branch of theorems is already closed.
+std::shared_ptr<const GoalExpansion> expandTheorems(const std::set<Formula> &theorems)
+{
+    NodeArena::Heap heap;
+    GoalExpansion e;
+
+    for (auto i = theorems.cbegin(); i!=theorems.cend(); ++i) {
+        e.add(*i);
     }
 
-    return false;
+    if (expandPending(e)==false) {
+        return std::shared_ptr<const GoalExpansion>();
+    }
+
+    return std::make_shared<const GoalExpansion>(std::move(e));
 }
 
-void systemToLiterals(System &goals)
+std::shared_ptr<const GoalExpansion> expandTheorem(const std::shared_ptr<const GoalExpansion> &expanded,
+                                                   const Formula &formula)
 {
-    while (goals.empty()==false) {
-        if (tryLiteral(goals)) {
-            continue;
-        }
+    if (!expanded) {
+        return expanded;
+    }
 
-        if (tryAlphaGamaDelta(goals)) {
-            continue;
-        }
+    GoalExpansion e = *expanded;
 
-        if (tryBeta(goals)) {
-            continue;
-        }
+    e.add(formula);
 
-        break;
+    if (expandPending(e)==false) {
+        return std::shared_ptr<const GoalExpansion>();
     }
+
+    return std::make_shared<const GoalExpansion>(std::move(e));
 }
 
-bool containsInequality(const Goal &goal, const Term &t1, const Term &t2)
+GammaBudget::GammaBudget(std::size_t instances) :
+    instances(instances),
+    exhausted(false)
 {
-    for (auto i = goal.cbegin(); i!=goal.cend(); ++i) {
-        const Formula &f = *i;
+}
 
-        if (f.type()==NONEQUALITY) {
-            bool found1 = false;
-            bool found2 = false;
+void systemToLiterals(System &goals)
+{
+    GammaBudget budget(1);
 
-            for (size_t i = 0; i<f.terms().size(); ++i) {
-                if (found1==false && f.terms()[i]==t1) {
-                    if (found2) {
-                        return true;
-                    }
+    systemToLiterals(goals, budget);
+}
 
-                    found1 = true;
-                } else if (found2==false && f.terms()[i]==t2) {
-                    if (found1) {
-                        return true;
-                    }
+// All branches go through one subsumption index while they are made, so
+// no goal of the result includes another one.
+void systemToLiterals(System &goals, GammaBudget &budget)
+{
+    System result;
+    SubsumptionIndex index;
 
-                    found2 = true;
-                }
-            }
-        }
+    for (auto i = goals.cbegin(); i!=goals.cend(); ++i) {
+        expandGoal(*i, result, index, budget);
     }
 
-    return false;
+    goals = std::move(result);
+}
+
+bool containsInequality(const Goal &goal, const Term &t1, const Term &t2)
+{
+    return DisequalityIndex(goal).contains(t1, t2);
 }
 
 bool produceInequalities(const Goal &goal, std::set<Goal> &result)
 {
+    DisequalityIndex disequalities(goal);
+
     result.clear();
 
     for (auto i = goal.cbegin(); i!=goal.cend(); ++i) {
@@ -367,7 +502,7 @@ bool produceInequalities(const Goal &goal, std::set<Goal> &result)
                     bool found = false;
 
                     for (size_t l=0; l<t1.args().size() && l<t2.args().size(); ++l) {
-                        if (containsInequality(goal, t1.args()[l], t2.args()[l])) {
+                        if (disequalities.contains(t1.args()[l], t2.args()[l])) {
                             found = true;
 
                             break;
@@ -416,7 +551,7 @@ bool produceInequalities(const Goal &goal, std::set<Goal> &result)
                 bool found = false;
 
                 for (size_t l=0; l<f1.terms().size() && l<f2.terms().size(); ++l) {
-                    if (containsInequality(goal, f1.terms()[l], f2.terms()[l])) {
+                    if (disequalities.contains(f1.terms()[l], f2.terms()[l])) {
                         found = true;
 
                         break;
@@ -448,86 +583,7 @@ bool produceInequalities(const Goal &goal, std::set<Goal> &result)
 
 std::vector<std::set<Term>> equivalenceClasses(const Goal &goal)
 {
-    std::vector<std::set<Term>> result;
-
-    for (auto i = goal.cbegin(); i!=goal.cend(); ++i) {
-        const Formula &f = *i;
-
-        if (f.type()==EQUALITY) {
-            size_t pos = result.size();
-
-            for (size_t j = 0; j<f.terms().size(); ++j) {
-                const Term &t = f.terms()[j];
-                bool found = false;
-
-                for (size_t k = 0; k<result.size(); ++k) {
-                    if (result[k].count(t)>0) {
-                        found = true;
-
-                        if (k!=pos) {
-                            if (pos<result.size()) {
-                                std::set<Term> u = std::move(result[k]);
-
-                                for (auto l = result[pos].cbegin(); l!=result[pos].cend(); ++l) {
-                                    u.insert(*l);
-                                }
-
-                                std::vector<std::set<Term>> newResult;
-
-                                for (size_t l = 0; l<result.size(); ++l) {
-                                    if (l!=k && l!=pos) {
-                                        newResult.push_back(std::move(result[l]));
-                                    }
-                                }
-
-                                result = std::move(newResult);
-                                result.push_back(std::move(u));
-                                pos = result.size()-1;
-                            } else {
-                                result[k].insert(t);
-                                pos = k;
-                            }
-                        }
-
-                        break;
-                    }
-                }
-
-                if (found==false) {
-                    if (pos<result.size()) {
-                        result[pos].insert(t);
-                    } else {
-                        std::set<Term> s;
-
-                        s.insert(t);
-                        result.push_back(std::move(s));
-                        pos = result.size()-1;
-                    }
-                }
-            }
-        } else if (f.type()==NONEQUALITY) {
-            for (size_t j = 0; j<f.terms().size(); ++j) {
-                const Term &t = f.terms()[j];
-
-                size_t pos;
-
-                for (pos = 0; pos<result.size(); ++pos) {
-                    if (result[pos].count(t)>0) {
-                        break;
-                    }
-                }
-
-                if (pos==result.size()) {
-                    std::set<Term> s;
-
-                    s.insert(t);
-                    result.push_back(s);
-                }
-            }
-        }
-    }
-
-    return result;
+    return CongruenceClosure(goal).classes();
 }
 
 void produceInequalities(System &goals)
@@ -535,6 +591,8 @@ void produceInequalities(System &goals)
     while (true) {
         bool changed = false;
 
+        ProofControl::check();
+
         for (auto i = goals.cbegin(); i!=goals.cend(); ++i) {
             std::set<Goal> replacement;
 
@@ -545,6 +603,7 @@ void produceInequalities(System &goals)
                     }
                 }
 
+                ProofControl::allocated(systemBytes(replacement));
                 goals = replacement;
                 changed = true;
 
@@ -560,38 +619,16 @@ void produceInequalities(System &goals)
     }
 }
 
+// A goal is contradictory when two terms of some nonequality are in the
+// same class of the congruence closure of its equalities.
 void removeEqualityInequalityContradictions(System &goals)
 {
     std::set<Goal> gs;
 
     for (auto i = goals.cbegin(); i!=goals.cend(); ++i) {
-        bool found = false;
-        auto c = equivalenceClasses(*i);
-
-        for (size_t j = 0; j<c.size(); ++j) {
-            const std::set<Term> terms = c[j];
+        CongruenceClosure closure(*i);
 
-            for (auto k=terms.cbegin(); k!=terms.cend(); ++k) {
-                for (auto l=k; l!=terms.cend(); ++l) {
-                    if (containsInequality(*i, *k, *l)) {
-                        containsInequality(*i, *k, *l);
-                        found = true;
-
-                        break;
-                    }
-                }
-
-                if (found) {
-                    break;
-                }
-            }
-
-            if (found) {
-                break;
-            }
-        }
-
-        if (found==false) {
+        if (DisequalityIndex(*i).contradicts(closure)==false) {
             gs.insert(*i);
         }
     }
@@ -599,23 +636,61 @@ void removeEqualityInequalityContradictions(System &goals)
     goals = std::move(gs);
 }
 
-bool concludeContradiction(const System &system)
+// Applies the pruning steps, returns whether every goal is closed.
+bool closeGoals(System &goals, GammaBudget &budget)
 {
-    System goals = system;
-    
-    removeSupergoals(goals);
-    systemToLiterals(goals);
+    ProofControl::node();
     removeSupergoals(goals);
+    systemToLiterals(goals, budget);
+    ProofControl::check();
     produceInequalities(goals);
     removeSupergoals(goals);
     removeEqualityInequalityContradictions(goals);
 
-    if (goals.empty()) {
-        return true;
+    return goals.empty();
+}
+
+// The system without it's first goal under substitution. It's bytes are
+// reported here, once for every branch.
+System branchSystem(const System &goals, const Substitution &substitution)
+{
+    System result;
+
+    for (auto g = std::next(goals.cbegin()); g!=goals.cend(); ++g) {
+        Goal newGoal;
+
+        for (auto f = g->cbegin(); f!=g->cend(); ++f) {
+            newGoal.insert((*f)[substitution]);
+        }
+
+        result.insert(std::move(newGoal));
     }
 
+    ProofControl::allocated(systemBytes(result));
+
+    return result;
+}
+
+// Calls visit for the rest of the system under every substitution which
+// may close the first goal, until visit returns true. These branches are
+// independent, the system is contradictory if one of them is.
+bool forEachBranch(const System &goals, const std::function<bool(const System&)> &visit)
+{
     const Goal &goal = *(goals.cbegin());
-    auto c = equivalenceClasses(goal);
+    CongruenceClosure closure(goal);
+    auto c = closure.classes();
+    std::unordered_map<std::size_t, std::size_t> positions;
+    std::vector<TermIndex> indexes(c.size());
+
+    for (size_t j = 0; j<c.size(); ++j) {
+        positions[closure.classOf(*c[j].cbegin())] = j;
+    }
+
+    for (size_t j = 0; j<c.size(); ++j) {
+        for (auto k = c[j].cbegin(); k!=c[j].cend(); ++k) {
+            indexes[j].insert(*k);
+        }
+    }
 
     for (auto j = goal.cbegin(); j!=goal.cend(); ++j) {
         const Formula &formula = *j;
@@ -624,51 +699,23 @@ bool concludeContradiction(const System &system)
             for (size_t k = 1; k<formula.terms().size(); ++k) {
                 const Term &t1 = formula.terms()[k];
 
-                size_t p1;
-
-                for (p1 = 0; p1<c.size(); ++p1) {
-                    if (c[p1].count(t1)>0) {
-                        break;
-                    }
-                }
-
-                const std::set<Term> &c1 = c[p1];
+                const std::set<Term> &c1 = c[positions[closure.classOf(t1)]];
 
                 for (size_t l = 0; l<k; ++l) {
                     const Term &t2 = formula.terms()[l];
-                    size_t p2;
-
-                    for (p2 = 0; p2<c.size(); ++p2) {
-                        if (c[p2].count(t2)>0) {
-                            break;
-                        }
-                    }
-
-                    const std::set<Term> &c2 = c[p2];
+                    size_t p2 = positions[closure.classOf(t2)];
 
                     for (auto q1 = c1.cbegin(); q1!=c1.cend(); ++q1) {
+                        const std::set<Term> c2 = indexes[p2].unifiable(*q1);
+
                         for (auto q2 = c2.cbegin(); q2!=c2.cend(); ++q2) {
                             bool ok;
-                            Substitution substitution = TermEnvironment::unificator(t1, t2, ok);
-
-                            if (ok) {
-                                System newSystem;
-
-                                for (auto g = goals.cbegin(); g!=goals.cend(); ++g) {
-                                    if (g!=goals.cbegin()) {
-                                        Goal newGoal;
 
-                                        for (auto f = g->cbegin(); f!=g->cend(); ++f) {
-                                            newGoal.insert((*f)[substitution]);
-                                        }
+                            ProofControl::unification();
+                            Substitution substitution = TermEnvironment::unificator(*q1, *q2, ok);
 
-                                        newSystem.insert(newGoal);
-                                    }
-                                }
-
-                                if (concludeContradiction(newSystem)) {
-                                    return true;
-                                }
+                            if (ok && visit(branchSystem(goals, substitution))) {
+                                return true;
                             }
                         }
                     }
@@ -687,40 +734,31 @@ bool concludeContradiction(const System &system)
                 for (size_t l = 0; l<k; ++l) {
                     const Term &t2 = formula.terms()[l];
 
-                    for (auto cl = c.cbegin(); cl!=c.cend(); ++cl) {
-                        const std::set<Term> &cls = *cl;
+                    for (auto cl = indexes.cbegin(); cl!=indexes.cend(); ++cl) {
+                        const std::set<Term> cls1 = cl->unifiable(t1);
+
+                        if (cls1.empty()) {
+                            continue;
+                        }
+
+                        const std::set<Term> cls2 = cl->unifiable(t2);
 
-                        for (auto tm1 = cls.cbegin(); tm1!=cls.cend(); ++tm1) {
+                        for (auto tm1 = cls1.cbegin(); tm1!=cls1.cend(); ++tm1) {
                             Term trm1 = *tm1;
 
-                            for (auto tm2 = cls.cbegin(); tm2!=cls.cend(); ++tm2) {
+                            for (auto tm2 = cls2.cbegin(); tm2!=cls2.cend(); ++tm2) {
                                 Term trm2 = *tm2;
                                 bool ok;
                                 std::vector<std::pair<Term, Term>> unificationTask;
 
                                 unificationTask.push_back(std::pair<Term, Term>(t1, trm1));
                                 unificationTask.push_back(std::pair<Term, Term>(t2, trm2));
+                                ProofControl::unification();
 
                                 Substitution substitution =TermEnvironment::unificator(unificationTask, ok);
 
-                                if (ok) {
-                                    System newSystem;
-
-                                    for (auto g = goals.cbegin(); g!=goals.cend(); ++g) {
-                                        if (g!=goals.cbegin()) {
-                                            Goal newGoal;
-
-                                            for (auto f = g->cbegin(); f!=g->cend(); ++f) {
-                                                newGoal.insert((*f)[substitution]);
-                                            }
-
-                                            newSystem.insert(newGoal);
-                                        }
-                                    }
-
-                                    if (concludeContradiction(newSystem)) {
-                                        return true;
-                                    }
+                                if (ok && visit(branchSystem(goals, substitution))) {
+                                    return true;
                                 }
                             }
                         }
@@ -730,31 +768,198 @@ bool concludeContradiction(const System &system)
         }
     }
 
-    return goals.empty();
+    return false;
+}
+
+// The search is a search for a closed system reachable from system, so a
+// system met before is skipped. It was either searched without success or
+// is still searched above.
+bool concludeContradiction(const System &system, GammaBudget &budget, TranspositionTable &table)
+{
+    if (table.visit(system)) {
+        return false;
+    }
+
+    System goals = system;
+
+    ProofControl::allocated(systemBytes(goals));
+
+    if (closeGoals(goals, budget)) {
+        return true;
+    }
+
+    return forEachBranch(goals, [&budget, &table](const System &newSystem) {
+        return concludeContradiction(newSystem, budget, table);
+    });
+}
+
+bool concludeContradiction(const System &system, GammaBudget &budget)
+{
+    TranspositionTable table;
+
+    return concludeContradiction(system, budget, table);
+}
+
+bool concludeContradiction(const System &system)
+{
+    GammaBudget budget(1);
+
+    return concludeContradiction(system, budget);
+}
+
+// State shared by branches of a parallel search.
+struct ParallelSearch
+{
+    TranspositionTable table;
+    WorkPool pool;
+    std::atomic<bool> closed;
+    std::atomic<bool> stopped;
+    ProofControl *control;
+    GammaBudget &budget;
+
+    ParallelSearch(std::size_t threads, GammaBudget &budget) :
+        pool(threads),
+        closed(false),
+        stopped(false),
+        control(ProofControl::active()),
+        budget(budget)
+    {
+    }
+};
+
+// A branch found under system is submitted as a new task when some worker
+// is idle, otherwise it is searched right here, depth first, so tasks
+// waiting in the pool do not grow with the breadth of the search. When one
+// branch closes, or fails with an exception, the others stop before their
+// next step. A branch met before is not searched again, as in serial search.
+void searchBranch(const System &system, ParallelSearch &search)
+{
+    if (search.stopped) {
+        return;
+    }
+
+    ProofControl::Scope scope(search.control);
+
+    try {
+        if (search.table.visit(system)) {
+            return;
+        }
+
+        System goals = system;
+
+        ProofControl::allocated(systemBytes(goals));
+
+        if (closeGoals(goals, search.budget)) {
+            search.closed = true;
+            search.stopped = true;
+
+            return;
+        }
+
+        forEachBranch(goals, [&search](const System &newSystem) {
+            if (search.stopped) {
+                return true;
+            }
+
+            if (search.pool.hungry()==false) {
+                searchBranch(newSystem, search);
+
+                return (bool)search.stopped;
+            }
+
+            std::shared_ptr<const System> branch = std::make_shared<const System>(newSystem);
+
+            ProofControl::allocated(sizeof(std::function<void()>));
+
+            search.pool.submit([branch, &search] {
+                searchBranch(*branch, search);
+            });
+
+            return false;
+        });
+    } catch (...) {
+        search.stopped = true;
+
+        throw;
+    }
+}
+
+// Same answer as concludeContradiction, with branches explored by a pool of
+// given number of threads. Serial search is used for less than two threads.
+// Workers report to the ProofControl active in the calling thread. A branch
+// may close while another one is stopped by a limit, then the system is
+// contradictory anyway.
+bool concludeContradiction(const System &system, std::size_t threads)
+{
+    GammaBudget budget(1);
+
+    return concludeContradiction(system, threads, budget);
+}
+
+bool concludeContradiction(const System &system, std::size_t threads, GammaBudget &budget)
+{
+    if (threads<2) {
+        return concludeContradiction(system, budget);
+    }
+
+    ParallelSearch search(threads, budget);
+
+    search.pool.submit([&system, &search] {
+        searchBranch(system, search);
+    });
+
+    try {
+        search.pool.wait();
+    } catch (...) {
+        if (search.closed==false) {
+            throw;
+        }
+    }
+
+    return search.closed;
 }
 
 Theory::Theory(const std::set<Formula> &axioms) :
     axioms(axioms)
 {
     theoremsSet = axioms;
+    expanded = expandTheorems(axioms);
+
+    for (std::set<Formula>::const_iterator i = axioms.cbegin(); i != axioms.cend(); ++i) {
+        addPattern(*i);
+    }
 }
 
 Theory::Theory(std::set<Formula> &&axioms) :
     axioms(axioms)
 {
     theoremsSet = axioms;
+    expanded = expandTheorems(axioms);
+
+    for (std::set<Formula>::const_iterator i = axioms.cbegin(); i != axioms.cend(); ++i) {
+        addPattern(*i);
+    }
 }
 
 Theory::Theory(const Theory &theory) :
     axioms(theory.axioms)
 {
     theoremsSet = axioms;
+    expanded = expandTheorems(axioms);
+
+    for (std::set<Formula>::const_iterator i = axioms.cbegin(); i != axioms.cend(); ++i) {
+        addPattern(*i);
+    }
 }
 
 Theory::Theory(Theory &&theory) :
     axioms(theory.axioms)
 {
+    std::lock_guard<std::mutex> lock(theory.mutex);
+
     theoremsSet = std::move(theory.theoremsSet);
+    expanded = theory.expanded;
+    patterns = std::move(theory.patterns);
 }
 
 const std::set<Formula> &Theory::theorems() const
@@ -762,30 +967,169 @@ const std::set<Formula> &Theory::theorems() const
     return theoremsSet;
 }
 
+// Free variables of a theorem may be instantiated by draw anyway, so an
+// instance of a theorem is contained as well, and so is a variant of it.
 bool Theory::contains(const Formula &formula) const
 {
-    return theoremsSet.count(formula) > 0;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (theoremsSet.count(formula) > 0) {
+        return true;
+    }
+
+    std::vector<std::pair<Variable, Term>> bindings;
+    auto range = patterns.equal_range(shape(formula));
+
+    for (auto i = range.first; i != range.second; ++i) {
+        bindings.clear();
+
+        if (FormulaEnvironment::match(i->second, formula, bindings)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Must be called with the mutex locked.
+void Theory::addPattern(const Formula &formula) const
+{
+    patterns.emplace(shape(formula), formula);
 }
 
-bool Theory::draw(const Formula &formula) const
+// Hash of the connectives, relation symbols and numbers of bound variables
+// of the formula. Terms are left out, so an instance or a variant of a
+// formula has the same shape.
+std::size_t Theory::shape(const Formula &formula)
+{
+    std::size_t result = hashCombine(formula.type(), formula.variables().size());
+
+    if (formula.type()==RELATION) {
+        result = hashCombine(result, formula.symbol().id);
+    }
+
+    for (std::size_t i = 0; i<formula.formulas().size(); ++i) {
+        result = hashCombine(result, shape(formula.formulas()[i]));
+    }
+
+    return result;
+}
+
+bool Theory::draw(const Formula &formula, std::size_t threads) const
+{
+    return draw(formula, nullptr, threads).result==PROVED;
+}
+
+// Stops with UNKNOWN and the reason from control when a limit of control is
+// reached or control is cancelled.
+ProofOutcome Theory::draw(const Formula &formula, ProofControl &control, std::size_t threads) const
+{
+    return draw(formula, &control, threads);
+}
+
+// The negated formula is added to the expanded theorems, which are shared
+// by all calls and extended when a theorem is added, so only the formula
+// and the beta formulas are expanded. The negated formula is expanded before
+// any beta formula is split, as it would be in a goal with the theorems.
+ProofOutcome Theory::draw(const Formula &formula, ProofControl *control, std::size_t threads) const
 {
     if (contains(formula)) {
-        return true;
+        return ProofOutcome(PROVED);
     }
 
-    Goal g = theoremsSet;
+    ProofControl::Scope scope(control);
+    NodeArena arena;
+    std::shared_ptr<const GoalExpansion> theorems;
 
-    g.insert(FormulaEnvironment::NegationFormula(formula));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
 
-    System s;
+        theorems = expanded;
+    }
 
-    s.insert(g);
+    if (!theorems) {
+        return ProofOutcome(PROVED);
+    }
 
-    if (concludeContradiction(s)) {
-        theoremsSet.insert(formula);
+    const Formula negation = FormulaEnvironment::NegationFormula(formula);
 
-        return true;
+    // Iterative deepening on instances of gamma formulas per branch. When
+    // no branch used all instances it was allowed, a round with more of them
+    // builds the same system, so the search is complete. A round resumes
+    // the open branches of the previous one from their parked gamma
+    // formulas, closed branches stay closed with more instances. The search
+    // on the system of literals starts again, as met systems which were not
+    // contradictory might be with more instances.
+    const std::size_t maximum = control==nullptr ? 1 : control->instanceLimit();
+    std::vector<GoalExpansion> branches(1, *theorems);
+
+    branches[0].add(negation);
+
+    for (std::size_t instances = 1; ; ++instances) {
+        GammaBudget budget(instances);
+        bool proved;
+
+        try {
+            std::vector<GoalExpansion> open;
+            System s;
+
+            expandBranches(branches, open, budget);
+
+            for (auto i = open.cbegin(); i!=open.cend(); ++i) {
+                s.insert(i->literals.toSet());
+            }
+
+            branches = std::move(open);
+            proved = concludeContradiction(s, threads, budget);
+        } catch (const ProofStoppedException&) {
+            return ProofOutcome(UNKNOWN, control->reason());
+        }
+
+        if (proved) {
+            addTheorem(formula);
+
+            return ProofOutcome(PROVED);
+        }
+
+        if (budget.exhausted==false) {
+            return ProofOutcome(REFUTED);
+        }
+
+        if (maximum>0 && instances>=maximum) {
+            return ProofOutcome(UNKNOWN, INSTANCE_LIMIT_REACHED);
+        }
     }
+}
 
-    return false;
+// The theorem is expanded outside the lock. If another theorem was added
+// meanwhile, it is expanded again from the new state.
+void Theory::addTheorem(const Formula &formula) const
+{
+    // The theorem and it's expansion outlive the search which proved it.
+    NodeArena::Heap heap;
+    const Formula theorem = formula.persistent();
+    std::shared_ptr<const GoalExpansion> current;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        current = expanded;
+    }
+
+    while (true) {
+        std::shared_ptr<const GoalExpansion> extended = expandTheorem(current, theorem);
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (expanded==current) {
+            if (theoremsSet.insert(theorem).second) {
+                addPattern(theorem);
+            }
+
+            expanded = extended;
+
+            return;
+        }
+
+        current = expanded;
+    }
 }
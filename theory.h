@@ -1,7 +1,12 @@
 #ifndef THEORY_H
 #define THEORY_H
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <language.h>
+#include "prooflimits.h"
 
 typedef std::set<Formula> Goal;
 
@@ -12,18 +17,51 @@ bool operator <(const Goal &first, const Goal &second);
 typedef std::set<Goal> System;
 
 int cmp(const Goal &g1, const Goal &g2);
+// Estimates of heap bytes taken by a goal or a system, reported to
+// ProofControl::allocated by a search.
+std::size_t goalBytes(const Goal &goal);
+std::size_t systemBytes(const System &system);
 void removeSupergoals(System &goals);
+// Number of instances of every gamma formula in a branch made by goal
+// expansion. Expansion sets exhausted when some open branch reached it.
+struct GammaBudget
+{
+    const std::size_t instances;
+    std::atomic<bool> exhausted;
+
+    GammaBudget(std::size_t instances);
+};
+
 void systemToLiterals(System &goals);
+void systemToLiterals(System &goals, GammaBudget &budget);
 bool containsInequality(const Goal &goal, const Term &t1, const Term &t2);
 bool produceInequalities(const Goal &goal, std::set<Goal> &result);
 std::vector<std::set<Term>> equivalenceClasses(const Goal &goal);
 void produceInequalities(System &goals);
 void removeEqualityInequalityContradictions(System &goals);
 bool concludeContradiction(const System &system);
+bool concludeContradiction(const System &system, std::size_t threads);
+bool concludeContradiction(const System &system, std::size_t threads, GammaBudget &budget);
+
+struct GoalExpansion;
 
+// Theorems are guarded by a mutex, so draw can be called from many threads.
+// Reference returned by theorems is not guarded.
 class Theory
 {
+    mutable std::mutex mutex;
     mutable std::set<Formula> theoremsSet;
+    // Theorems expanded by every rule but beta, draw takes them in constant
+    // time. Null pointer if theorems are contradictory.
+    mutable std::shared_ptr<const GoalExpansion> expanded;
+    // Theorems by their shape, which is kept by instantiation and renaming
+    // of bound variables, so contains matches only theorems of that shape.
+    mutable std::unordered_multimap<std::size_t, Formula> patterns;
+
+    ProofOutcome draw(const Formula &formula, ProofControl *control, std::size_t threads) const;
+    void addTheorem(const Formula &formula) const;
+    void addPattern(const Formula &formula) const;
+    static std::size_t shape(const Formula &formula);
 
 public:
     const std::set<Formula> axioms;
@@ -34,7 +72,8 @@ public:
     Theory(Theory &&theory);
     const std::set<Formula>& theorems() const;
     bool contains(const Formula &formula) const;
-    bool draw(const Formula &formula) const;
+    bool draw(const Formula &formula, std::size_t threads = 1) const;
+    ProofOutcome draw(const Formula &formula, ProofControl &control, std::size_t threads = 1) const;
 };
 
 #endif // THEORY_H
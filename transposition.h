@@ -0,0 +1,94 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+/*!
+    \file "transposition.h"
+
+    \author Nedeljko Stefanovic
+
+    \brief Table of systems met by one proof search.
+
+    A system is stored as two hashes of it's canonical form, where
+    variables are numbered in order of their first occurrence. Goals and
+    their formulas are visited in order of hashes which do not depend on
+    names of variables, so systems which differ only in names of variables
+    mostly get the same canonical form. Formulas with equal hashes may still
+    be visited in different orders, then an equivalent system is not found.
+    The first hash is the key, the second one is compared only when the key
+    is found, and a system with the same key but a different second hash
+    replaces the stored one. Systems with both hashes equal are taken as
+    equivalent, a collision of both may only make the search skip a system
+    it should search. Only systems of literals are stored.
+
+    The table takes at most given number of bytes, the least recently met
+    system is evicted first. Bytes of new entries are reported to the
+    active ProofControl (see "prooflimits.h"). It may be used from many
+    threads.
+*/
+
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include "theory.h"
+
+class TranspositionTable
+{
+    struct Entry
+    {
+        std::size_t hash;
+        std::size_t check;
+
+        DECLARE Entry(std::size_t hash, std::size_t check);
+    };
+
+    mutable std::mutex mutex;
+    const std::size_t capacity;
+    std::list<Entry> entries;
+    std::unordered_map<std::size_t, std::list<Entry>::iterator> index;
+
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator =(const TranspositionTable&) = delete;
+    DECLARE static std::size_t entryBytes();
+    DECLARE static void add(Entry &key, uint64_t value);
+    DECLARE static bool literal(const Formula &formula);
+    DECLARE static bool blindHash(const Term &term, std::size_t &result);
+    DECLARE static bool blindHash(const Formula &formula, std::size_t &result);
+    DECLARE static void canonicalHash(const Term &term, std::map<Variable, std::size_t> &numbers, Entry &key);
+    DECLARE static void canonicalHash(const Formula &formula, std::map<Variable, std::size_t> &numbers, Entry &key);
+    DECLARE static bool canonical(const System &system, Entry &key);
+
+public:
+    DECLARE TranspositionTable(std::size_t capacity = 4194304);
+    DECLARE bool visit(const System &system);
+    DECLARE std::size_t size() const;
+};
+
+#ifdef INLINE
+
+#include "transposition_imp.h"
+
+#endif
+
+#endif // TRANSPOSITION_H
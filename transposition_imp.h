@@ -0,0 +1,291 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#ifndef TRANSPOSITION_IMP_H
+#define TRANSPOSITION_IMP_H
+
+#include <algorithm>
+#include <vector>
+#include "prooflimits.h"
+#include "transposition.h"
+
+TranspositionTable::Entry::Entry(std::size_t hash, std::size_t check) :
+    hash(hash),
+    check(check)
+{
+}
+
+// An entry, it's node in the list and it's node and bucket in the index.
+std::size_t TranspositionTable::entryBytes()
+{
+    return sizeof(Entry) + 2*sizeof(void*) + sizeof(std::pair<const std::size_t, std::list<Entry>::iterator>) + 2*sizeof(void*);
+}
+
+void TranspositionTable::add(Entry &key, uint64_t value)
+{
+    key.hash = hashCombine(key.hash, value);
+    key.check = hashCombine(key.check, value);
+}
+
+bool TranspositionTable::blindHash(const Term &term, std::size_t &result)
+{
+    if (term.type()==VARIABLE) {
+        result = hashCombine(result, VARIABLE);
+
+        return true;
+    }
+
+    result = hashCombine(hashCombine(result, term.type()), term.id());
+
+    const std::vector<Term> &args = term.args();
+
+    for (auto i = args.cbegin(); i!=args.cend(); ++i) {
+        blindHash(*i, result);
+    }
+
+    return true;
+}
+
+bool TranspositionTable::literal(const Formula &formula)
+{
+    switch (formula.type()) {
+    case FALSE_SYMBOL:
+    case TRUE_SYMBOL:
+    case RELATION:
+    case EQUALITY:
+    case NONEQUALITY:
+        return true;
+
+    case NEGATION:
+        return literal(formula.formulas()[0]);
+
+    default:
+        return false;
+    }
+}
+
+// Returns false if formula is not a literal.
+bool TranspositionTable::blindHash(const Formula &formula, std::size_t &result)
+{
+    result = hashCombine(hashCombine(result, formula.type()), formula.id());
+
+    switch (formula.type()) {
+    case FALSE_SYMBOL:
+    case TRUE_SYMBOL:
+        return true;
+
+    case RELATION:
+    case EQUALITY:
+    case NONEQUALITY:
+        for (auto i = formula.terms().cbegin(); i!=formula.terms().cend(); ++i) {
+            blindHash(*i, result);
+        }
+
+        return true;
+
+    case NEGATION:
+        return blindHash(formula.formulas()[0], result);
+
+    default:
+        return false;
+    }
+}
+
+void TranspositionTable::canonicalHash(const Term &term, std::map<Variable, std::size_t> &numbers, Entry &key)
+{
+    if (term.type()==VARIABLE) {
+        const Variable variable(term.symbol());
+        auto number = numbers.insert(std::pair<Variable, std::size_t>(variable, numbers.size())).first;
+
+        add(key, VARIABLE);
+        add(key, number->second);
+
+        return;
+    }
+
+    add(key, term.type());
+    add(key, term.id());
+
+    for (auto i = term.args().cbegin(); i!=term.args().cend(); ++i) {
+        canonicalHash(*i, numbers, key);
+    }
+}
+
+void TranspositionTable::canonicalHash(const Formula &formula, std::map<Variable, std::size_t> &numbers, Entry &key)
+{
+    if (formula.isGround()) {
+        add(key, NONE_SYMBOL);
+        add(key, formula.serial());
+
+        return;
+    }
+
+    add(key, formula.type());
+    add(key, formula.id());
+
+    if (formula.type()==NEGATION) {
+        canonicalHash(formula.formulas()[0], numbers, key);
+
+        return;
+    }
+
+    for (auto i = formula.terms().cbegin(); i!=formula.terms().cend(); ++i) {
+        canonicalHash(*i, numbers, key);
+    }
+}
+
+// Returns false if system is not a system of literals.
+bool TranspositionTable::canonical(const System &system, Entry &key)
+{
+    typedef std::vector<std::pair<std::size_t, const Formula*>> Keyed;
+
+    std::vector<Keyed> goals;
+
+    goals.reserve(system.size());
+
+    for (auto i = system.cbegin(); i!=system.cend(); ++i) {
+        Keyed goal;
+
+        goal.reserve(i->size());
+
+        for (auto j = i->cbegin(); j!=i->cend(); ++j) {
+            std::size_t blind = 0;
+
+            // A ground literal is the same in every renaming, it's serial
+            // number tells it apart.
+            if (j->isGround()) {
+                if (literal(*j)==false) {
+                    return false;
+                }
+
+                blind = hashCombine(NONE_SYMBOL, j->serial());
+            } else if (blindHash(*j, blind)==false) {
+                return false;
+            }
+
+            goal.push_back(std::make_pair(blind, &*j));
+        }
+
+        std::stable_sort(goal.begin(), goal.end(),
+                         [](const std::pair<std::size_t, const Formula*> &a, const std::pair<std::size_t, const Formula*> &b) {
+                             return a.first<b.first;
+                         });
+        goals.push_back(std::move(goal));
+    }
+
+    std::vector<std::size_t> order(goals.size());
+
+    for (std::size_t i = 0; i<order.size(); ++i) {
+        order[i] = i;
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&goals](std::size_t a, std::size_t b) {
+        if (goals[a].size()!=goals[b].size()) {
+            return goals[a].size()<goals[b].size();
+        }
+
+        for (std::size_t i = 0; i<goals[a].size(); ++i) {
+            if (goals[a][i].first!=goals[b][i].first) {
+                return goals[a][i].first<goals[b][i].first;
+            }
+        }
+
+        return false;
+    });
+
+    std::map<Variable, std::size_t> numbers;
+
+    for (auto i = order.cbegin(); i!=order.cend(); ++i) {
+        for (auto j = goals[*i].cbegin(); j!=goals[*i].cend(); ++j) {
+            canonicalHash(*j->second, numbers, key);
+        }
+
+        add(key, goals[*i].size());
+    }
+
+    add(key, goals.size());
+
+    return true;
+}
+
+TranspositionTable::TranspositionTable(std::size_t capacity) :
+    capacity(capacity)
+{
+}
+
+// Returns true if a system with the same canonical form was met before,
+// otherwise stores system. The system met most recently is kept longest.
+bool TranspositionTable::visit(const System &system)
+{
+    // The second hash starts from another seed.
+    Entry key(0, 0x6a09e667f3bcc909ULL);
+
+    if (capacity<entryBytes() || canonical(system, key)==false) {
+        return false;
+    }
+
+    bool grown = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = index.find(key.hash);
+
+        if (found!=index.end()) {
+            entries.splice(entries.begin(), entries, found->second);
+
+            if (found->second->check==key.check) {
+                ProofControl::transposition(true);
+
+                return true;
+            }
+
+            ProofControl::transposition(false);
+            found->second->check = key.check;
+
+            return false;
+        }
+
+        ProofControl::transposition(false);
+        entries.emplace_front(key.hash, key.check);
+        index.insert(std::make_pair(key.hash, entries.begin()));
+
+        if (entries.size()*entryBytes()>capacity) {
+            index.erase(entries.back().hash);
+            entries.pop_back();
+        } else {
+            grown = true;
+        }
+    }
+
+    if (grown) {
+        ProofControl::allocated(entryBytes());
+    }
+
+    return false;
+}
+
+std::size_t TranspositionTable::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return entries.size();
+}
+
+#endif // TRANSPOSITION_IMP_H
@@ -0,0 +1,95 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+/*!
+    \file "workpool.h"
+
+    \author Nedeljko Stefanovic
+
+    \brief Work-stealing pool of threads.
+
+    Every worker has it's own deque of tasks. A task submitted by a worker
+    goes to the back of it's deque and the worker takes tasks from the back,
+    so it goes depth first through tasks it made. A worker with an empty
+    deque steals from the front of other deques, where the oldest and
+    usually largest tasks are. Tasks submitted by other threads are spread
+    over deques in turn. A worker which waits for a task is idle, so a task
+    may run it's subtasks itself unless some worker is idle. Every worker
+    allocates internal objects of terms and formulas from it's own
+    NodeArena (see "arena.h").
+*/
+
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "config.h"
+
+class WorkPool
+{
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<std::size_t> pending;
+    std::atomic<std::size_t> next;
+    std::atomic<std::size_t> idle;
+    std::mutex mutex;
+    std::condition_variable available;
+    std::condition_variable finished;
+    long queued;
+    bool stopping;
+    std::exception_ptr error;
+
+    WorkPool(const WorkPool&) = delete;
+    WorkPool& operator =(const WorkPool&) = delete;
+    DECLARE static const WorkPool*& currentPool();
+    DECLARE static std::size_t& currentWorker();
+    DECLARE bool take(std::size_t worker, std::function<void()> &task);
+    DECLARE void work(std::size_t worker);
+
+public:
+    DECLARE WorkPool(std::size_t threads);
+    DECLARE ~WorkPool();
+    DECLARE std::size_t size() const;
+    DECLARE bool hungry() const;
+    DECLARE void submit(std::function<void()> task);
+    DECLARE void wait();
+};
+
+#ifdef INLINE
+
+#include "workpool_imp.h"
+
+#endif
+
+#endif // WORKPOOL_H
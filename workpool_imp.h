@@ -0,0 +1,201 @@
+/*******************************************************************************
+*                                                                              *
+*     FunnyProof - Easy for use proof assistant.                               *
+*     Copyright (C) 2015  Nedeljko Stefanovic                                  *
+*                                                                              *
+*     This program is free software: you can redistribute it and/or modify     *
+*     it under the terms of version 3 of the GNU General Public License as     *
+*     published by the Free Software Foundation.                               *
+*                                                                              *
+*     This program is distributed in the hope that it will be useful,          *
+*     but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+*     GNU General Public License for more details.                             *
+*                                                                              *
+*     You should have received a copy of the GNU General Public License        *
+*     along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+*                                                                              *
+*******************************************************************************/
+
+
+#ifndef WORKPOOL_IMP_H
+#define WORKPOOL_IMP_H
+
+#include "arena.h"
+#include "workpool.h"
+
+const WorkPool*& WorkPool::currentPool()
+{
+    thread_local static const WorkPool *result = nullptr;
+
+    return result;
+}
+
+std::size_t& WorkPool::currentWorker()
+{
+    thread_local static std::size_t result = 0;
+
+    return result;
+}
+
+// Takes a task from the back of own deque, or steals one from the front of
+// another deque.
+bool WorkPool::take(std::size_t worker, std::function<void()> &task)
+{
+    for (std::size_t i = 0; i<queues.size(); ++i) {
+        Queue &queue = *queues[(worker+i)%queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (queue.tasks.empty()) {
+            continue;
+        }
+
+        if (i==0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+// Counter queued is changed under mutex after a task is pushed or taken,
+// so a worker does not sleep while some task is waiting. It is negative for
+// a moment when a task is taken before it's submission is counted.
+void WorkPool::work(std::size_t worker)
+{
+    NodeArena arena;
+
+    currentPool() = this;
+    currentWorker() = worker;
+
+    while (true) {
+        std::function<void()> task;
+
+        if (take(worker, task)) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                --queued;
+            }
+
+            try {
+                task();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+
+            if (--pending==0) {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                finished.notify_all();
+            }
+
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+
+        ++idle;
+        available.wait(lock, [this] { return queued>0 || stopping; });
+        --idle;
+
+        if (stopping && queued<=0) {
+            return;
+        }
+    }
+}
+
+WorkPool::WorkPool(std::size_t threads) :
+    pending(0),
+    next(0),
+    idle(0),
+    queued(0),
+    stopping(false)
+{
+    if (threads==0) {
+        threads = 1;
+    }
+
+    for (std::size_t i = 0; i<threads; ++i) {
+        queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    }
+
+    for (std::size_t i = 0; i<threads; ++i) {
+        workers.push_back(std::thread(&WorkPool::work, this, i));
+    }
+}
+
+WorkPool::~WorkPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        stopping = true;
+    }
+
+    available.notify_all();
+
+    for (auto i = workers.begin(); i!=workers.end(); ++i) {
+        i->join();
+    }
+}
+
+std::size_t WorkPool::size() const
+{
+    return workers.size();
+}
+
+// Whether some worker waits for a task.
+bool WorkPool::hungry() const
+{
+    return idle>0;
+}
+
+void WorkPool::submit(std::function<void()> task)
+{
+    std::size_t worker = currentPool()==this ? currentWorker() : next++%queues.size();
+
+    ++pending;
+
+    {
+        std::lock_guard<std::mutex> lock(queues[worker]->mutex);
+
+        queues[worker]->tasks.push_back(std::move(task));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        ++queued;
+    }
+
+    available.notify_one();
+}
+
+// Waits until every submitted task is finished. The first exception thrown
+// by a task is thrown again here.
+void WorkPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    finished.wait(lock, [this] { return pending==0; });
+
+    if (error) {
+        std::exception_ptr e = error;
+
+        error = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+#endif // WORKPOOL_IMP_H